@@ -1,6 +1,6 @@
 #include "astar.h"
-#include <queue>
-#include <glm/gtx/hash.hpp>
+#include <algorithm>
+#include <limits>
 #include "grid.h"
 
 
@@ -9,113 +9,336 @@ using namespace std;
 
 namespace rlf
 {
-	// useful for our priority queue
-	struct ivec2_and_weight_t {
-		ivec2 p;
-		float w;
-		bool operator < (const ivec2_and_weight_t& other) const { return w < other.w; }
-	};
-
 	// test if a point is within the map bounds
 	bool PointInMapBounds(const ivec2& p, const ivec2& mapSize)
 	{
 		return p.x >= 0 && p.x < mapSize.x&& p.y >= 0 && p.y < mapSize.y;
 	}
 
-	// Reconstruct the path from start to goal. 
-	// Actually do it backwards (goal to start) and reverse in the end
-	void ReconstructPath(vector<ivec2>& path, const ivec2& goal, const unordered_map<ivec2, ivec2>& cameFrom)
+	void PathFinder::BeginQuery(const ivec2& newMapSize)
 	{
-		path.push_back(goal);
-		auto it = cameFrom.find(goal);
-		while (it != cameFrom.end())
+		// (re)allocate the scratch arrays only if the map size changed
+		if (newMapSize != mapSize)
+		{
+			mapSize = newMapSize;
+			const auto numTiles = size_t(mapSize.x * mapSize.y);
+			visitGeneration.assign(numTiles, 0);
+			gScore.resize(numTiles);
+			fScore.resize(numTiles);
+			cameFrom.resize(numTiles);
+			arrivalDirection.resize(numTiles);
+			heapIndex.resize(numTiles);
+			generation = 0;
+		}
+		// Start a new generation. If the counter wraps around, we need to clear the stamps once, as old ones could now look valid
+		if (++generation == 0)
 		{
-			const auto& p = it->second;
-			path.push_back(p);
-			it = cameFrom.find(p);
+			std::fill(visitGeneration.begin(), visitGeneration.end(), 0);
+			generation = 1;
 		}
-		// remove last element, which should be the start point (we don't need it)
-		path.pop_back();
-		// reverse the path, as currently it's from goal to start
-		std::reverse(path.begin(), path.end());
+		heap.resize(0);
 	}
 
-	vector<ivec2> CalculatePath(const ivec2& start, const ivec2& goal, const ivec2& mapSize, const function<float(const glm::ivec2&)>& fnCost)
+	bool PathFinder::HeapLess(int nodeA, int nodeB) const
+	{
+		// lowest f-score first. On ties, prefer the tile that is further from the start (closer to the goal)
+		return fScore[nodeA] < fScore[nodeB] || (fScore[nodeA] == fScore[nodeB] && gScore[nodeA] > gScore[nodeB]);
+	}
+
+	void PathFinder::HeapSwap(int heapPosA, int heapPosB)
+	{
+		std::swap(heap[heapPosA], heap[heapPosB]);
+		heapIndex[heap[heapPosA]] = heapPosA;
+		heapIndex[heap[heapPosB]] = heapPosB;
+	}
+
+	void PathFinder::HeapSiftUp(int heapPos)
+	{
+		while (heapPos > 0)
+		{
+			int parentPos = (heapPos - 1) / 2;
+			if (!HeapLess(heap[heapPos], heap[parentPos]))
+				break;
+			HeapSwap(heapPos, parentPos);
+			heapPos = parentPos;
+		}
+	}
+
+	void PathFinder::HeapSiftDown(int heapPos)
+	{
+		const int heapSize = int(heap.size());
+		while (true)
+		{
+			int bestPos = heapPos;
+			int leftPos = 2 * heapPos + 1;
+			int rightPos = leftPos + 1;
+			if (leftPos < heapSize && HeapLess(heap[leftPos], heap[bestPos]))
+				bestPos = leftPos;
+			if (rightPos < heapSize && HeapLess(heap[rightPos], heap[bestPos]))
+				bestPos = rightPos;
+			if (bestPos == heapPos)
+				break;
+			HeapSwap(heapPos, bestPos);
+			heapPos = bestPos;
+		}
+	}
+
+	void PathFinder::HeapPush(int node)
+	{
+		heapIndex[node] = int(heap.size());
+		heap.push_back(node);
+		HeapSiftUp(heapIndex[node]);
+	}
+
+	int PathFinder::HeapPop()
+	{
+		// take the top, move the last element to the top and restore the heap property
+		int node = heap[0];
+		HeapSwap(0, int(heap.size()) - 1);
+		heap.pop_back();
+		heapIndex[node] = -1;
+		if (!heap.empty())
+			HeapSiftDown(0);
+		return node;
+	}
+
+	void PathFinder::HeapDecreaseKey(int node)
+	{
+		// the f-score only ever gets lower, so the node can only move towards the top
+		HeapSiftUp(heapIndex[node]);
+	}
+
+	vector<ivec2> PathFinder::CalculatePath(const ivec2& start, const ivec2& goal, const ivec2& mapSize, const function<float(const glm::ivec2&)>& fnCost)
 	{
 		// This means "impassable"
 		constexpr float INF_COST = std::numeric_limits<float>::infinity();
-		
+
 		// sanity check for our coordinates: start/goal being different, in map bounds, and goal not being unattainable
 		if (!(start != goal && PointInMapBounds(start, mapSize) && PointInMapBounds(goal, mapSize)))
 			return {};
 
+		BeginQuery(mapSize);
+
 		// Heuristic is the manhattan distance to goal
 		const auto fnHeuristic = [&goal](const ivec2& p) {
 			auto v = abs(p - goal);
-			return v.x + v.y;
+			return float(v.x + v.y);
 		};
-		
-		// This will store the g score: accumulated path cost from start to a point (which is the key to this map)
-		std::unordered_map<ivec2, float> gScore;
-		// This stores a map between a point (the key) and the point it came from (the value)
-		unordered_map<ivec2, ivec2> cameFrom;
-		// This is the frontier that we use to pick our candidate points. It's a priority queue, so we always want to pick the best candidate
-		priority_queue< ivec2_and_weight_t> frontier;
+		const auto fnToNode = [&mapSize](const ivec2& p) { return p.x + p.y * mapSize.x; };
+		const auto fnToPoint = [&mapSize](int node) { return ivec2(node % mapSize.x, node / mapSize.x); };
 
 		// start at the starting point
-		frontier.push({ start, 0 });
-		gScore[start] = 0.0f;
+		const int startNode = fnToNode(start);
+		const int goalNode = fnToNode(goal);
+		visitGeneration[startNode] = generation;
+		gScore[startNode] = 0.0f;
+		fScore[startNode] = fnHeuristic(start);
+		cameFrom[startNode] = -1;
+		HeapPush(startNode);
 
 		std::vector<ivec2> path;
 
 		// while we do have elements in the frontier to process
-		while (!frontier.empty())
+		while (!heap.empty())
 		{
 			// get the best candidate and remove it from the frontier
-			auto current = frontier.top().p;
-			frontier.pop();
+			const int currentNode = HeapPop();
 			// If it's the goal, reconstruct the path and exit
-			if (current == goal)
+			if (currentNode == goalNode)
 			{
-				ReconstructPath(path, goal, cameFrom);
+				// Actually do it backwards (goal to start) and reverse in the end. We don't need the start point
+				for (int node = goalNode; node != startNode; node = cameFrom[node])
+					path.push_back(fnToPoint(node));
+				std::reverse(path.begin(), path.end());
 				break;
-			}	
+			}
 
-			// get the g-score at this point (should be written)
-			auto gScoreCurrent = gScore.at(current);
+			const auto current = fnToPoint(currentNode);
+			const auto gScoreCurrent = gScore[currentNode];
 			// now check all 4 neighbours
 			for (const auto& nbOffset : Nb4())
 			{
 				// if a neighbour is within the map bounds
 				auto nb = current + nbOffset;
-				if (PointInMapBounds(nb, mapSize))
+				if (!PointInMapBounds(nb, mapSize))
+					continue;
+				// calculate the cost to go to that neighbour
+				// if it's the goal, allow any cost really (even inf), as we might plot a path to a blocker
+				auto costNb = nb == goal ? 1.0f : fnCost(nb);
+				// if the cost is "impassable", skip
+				if (costNb == INF_COST)
+					continue;
+				// calculate the new g-score, and see if it's better than an already recorded g-score for this tile, or if no entry is recorded yet
+				const int nbNode = fnToNode(nb);
+				const auto gScoreNbNew = gScoreCurrent + costNb;
+				const bool isVisited = IsVisited(nbNode);
+				if (isVisited && gScore[nbNode] <= gScoreNbNew)
+					continue;
+				if (!isVisited)
 				{
-					// calculate the cost to go to that neighbour					
-					// if it's the goal, allow any cost really (even inf), as we might plot a path to a blocker
-					auto costNb = nb == goal ? 1.0f : fnCost(nb); 
-					// if the cost is not "impassable"
-					if (costNb != INF_COST)
-					{
-						// calculate the new g-score, and see if it's better than an already recorded g-score for this tile, or if no entry is recorded yet
-						auto gScoreNbNew = gScoreCurrent + costNb;
-						auto gScoreNbCurIt = gScore.find(nb);
-						if (gScoreNbCurIt == gScore.end() || gScoreNbCurIt->second > gScoreNbNew)
-						{
-							// record the gscore
-							gScore[nb] = gScoreNbNew;
-							// calculate the fscore using the heuristic
-							// fscore = gScore + hScore => (actual cost from start to current) + (estimated cost from current to goal)
-							auto fScore = gScoreNbNew + fnHeuristic(nb);
-							// put this point into the frontier. Flip the sign of the fscore so that when we pick a point from the priority queue, it's the one with the closest-to-zero weight
-							frontier.push({ nb, -fScore });
-							// store where did the neighbour tile came from, for this recorded g-score
-							cameFrom[nb] = current;
-						}
-					}
+					visitGeneration[nbNode] = generation;
+					heapIndex[nbNode] = -1;
 				}
+				// record the g-score, the f-score and where did the neighbour tile came from
+				// fscore = gScore + hScore => (actual cost from start to current) + (estimated cost from current to goal)
+				gScore[nbNode] = gScoreNbNew;
+				fScore[nbNode] = gScoreNbNew + fnHeuristic(nb);
+				cameFrom[nbNode] = currentNode;
+				// put this point into the frontier, or move it up if it's already there
+				if (heapIndex[nbNode] >= 0)
+					HeapDecreaseKey(nbNode);
+				else
+					HeapPush(nbNode);
 			}
 		}
 
 		return path;
 	}
-}
\ No newline at end of file
+
+	vector<ivec2> PathFinder::CalculatePath(const ivec2& start, const ivec2& goal, const BitArray2D& blocked)
+	{
+		const auto& mapSize = blocked.Size();
+		if (!(start != goal && PointInMapBounds(start, mapSize) && PointInMapBounds(goal, mapSize)))
+			return {};
+
+		BeginQuery(mapSize);
+
+		const auto fnHeuristic = [&goal](const ivec2& p) {
+			auto v = abs(p - goal);
+			return float(v.x + v.y);
+		};
+		const auto fnToNode = [&mapSize](const ivec2& p) { return p.x + p.y * mapSize.x; };
+		const auto fnToPoint = [&mapSize](int node) { return ivec2(node % mapSize.x, node / mapSize.x); };
+		// the goal is always passable, as we might plot a path to a blocker
+		const auto fnIsOpen = [&](int x, int y) { return x >= 0 && x < mapSize.x && y >= 0 && y < mapSize.y && ((x == goal.x && y == goal.y) || !blocked.Get(x, y)); };
+
+		// Paths are searched in a canonical form: vertical runs can turn sideways at any tile, but horizontal runs only turn where an obstacle forces them to.
+		// Horizontal jump: walk until the goal, or a tile where an obstacle behind us ends above or below, so that a vertical move opens up that we couldn't have made earlier.
+		// Rows are scanned 64 tiles at a time, using the blocked bits of the row and the rows above and below
+		const int wordsPerRow = blocked.WordsPerRow();
+		// the blocked bits of a row word, with the goal open, and anything out of the map blocked
+		const auto fnBlockedWord = [&](int y, int word) {
+			if (y < 0 || y >= mapSize.y || word < 0 || word >= wordsPerRow)
+				return ~uint64_t(0);
+			auto bits = blocked.Row(y)[word];
+			if (word == wordsPerRow - 1 && (mapSize.x & 63) != 0)
+				bits |= ~uint64_t(0) << (mapSize.x & 63);
+			if (y == goal.y && word == (goal.x >> 6))
+				bits &= ~(uint64_t(1) << (goal.x & 63));
+			return bits;
+		};
+		const auto fnJumpHorizontal = [&](const ivec2& p, int dx, ivec2& jumpPoint) {
+			const int x = p.x + dx;
+			for (int word = x >> 6; word >= 0 && word < wordsPerRow; word += dx)
+			{
+				// a tile is forced if it's open above/below, but the tile behind it is not. The tile behind might be in the neighbouring word
+				const auto fnForced = [&](int y) {
+					auto bits = fnBlockedWord(y, word);
+					auto bitsBehind = dx > 0 ? (bits << 1) | (fnBlockedWord(y, word - 1) >> 63) : (bits >> 1) | (fnBlockedWord(y, word + 1) << 63);
+					return ~bits & bitsBehind;
+				};
+				const auto blockedBits = fnBlockedWord(p.y, word);
+				auto stopBits = blockedBits | fnForced(p.y - 1) | fnForced(p.y + 1);
+				if (p.y == goal.y && word == (goal.x >> 6))
+					stopBits |= uint64_t(1) << (goal.x & 63);
+				// ignore the tiles before the first one that we step on
+				if (word == (x >> 6))
+					stopBits &= dx > 0 ? ~uint64_t(0) << (x & 63) : ~uint64_t(0) >> (63 - (x & 63));
+				if (stopBits == 0)
+					continue;
+				const int bit = dx > 0 ? LowestSetBit(stopBits) : HighestSetBit(stopBits);
+				if ((blockedBits >> bit) & 1)
+					return false;
+				jumpPoint = { word * 64 + bit, p.y };
+				return true;
+			}
+			return false;
+		};
+		// Vertical jump: as above, but also stop at any tile where a horizontal jump would find something
+		const auto fnJumpVertical = [&](ivec2 p, int dy, ivec2& jumpPoint) {
+			ivec2 sideJumpPoint;
+			while (true)
+			{
+				p.y += dy;
+				if (!fnIsOpen(p.x, p.y))
+					return false;
+				if (p == goal
+					|| (fnIsOpen(p.x - 1, p.y) && !fnIsOpen(p.x - 1, p.y - dy))
+					|| (fnIsOpen(p.x + 1, p.y) && !fnIsOpen(p.x + 1, p.y - dy))
+					|| fnJumpHorizontal(p, -1, sideJumpPoint)
+					|| fnJumpHorizontal(p, 1, sideJumpPoint))
+				{
+					jumpPoint = p;
+					return true;
+				}
+			}
+		};
+
+		const int startNode = fnToNode(start);
+		const int goalNode = fnToNode(goal);
+		visitGeneration[startNode] = generation;
+		gScore[startNode] = 0.0f;
+		fScore[startNode] = fnHeuristic(start);
+		cameFrom[startNode] = -1;
+		arrivalDirection[startNode] = { 0,0 };
+		HeapPush(startNode);
+
+		std::vector<ivec2> path;
+		while (!heap.empty())
+		{
+			const int currentNode = HeapPop();
+			if (currentNode == goalNode)
+			{
+				// jump points are connected by straight runs, so fill in the tiles between them. Backwards, and reverse in the end, like above
+				for (int node = goalNode; node != startNode; node = cameFrom[node])
+				{
+					const auto from = fnToPoint(cameFrom[node]);
+					auto p = fnToPoint(node);
+					const ivec2 step((from.x > p.x) - (from.x < p.x), (from.y > p.y) - (from.y < p.y));
+					for (; p != from; p += step)
+						path.push_back(p);
+				}
+				std::reverse(path.begin(), path.end());
+				break;
+			}
+
+			const auto current = fnToPoint(currentNode);
+			const auto gScoreCurrent = gScore[currentNode];
+			for (const auto& direction : Nb4())
+			{
+				// never go back the way we came
+				if (direction == -arrivalDirection[currentNode])
+					continue;
+				ivec2 jumpPoint;
+				if (!(direction.y == 0 ? fnJumpHorizontal(current, direction.x, jumpPoint) : fnJumpVertical(current, direction.y, jumpPoint)))
+					continue;
+				const int jumpNode = fnToNode(jumpPoint);
+				const auto gScoreNew = gScoreCurrent + float(abs(jumpPoint.x - current.x) + abs(jumpPoint.y - current.y));
+				const bool isVisited = IsVisited(jumpNode);
+				if (isVisited && gScore[jumpNode] <= gScoreNew)
+					continue;
+				if (!isVisited)
+				{
+					visitGeneration[jumpNode] = generation;
+					heapIndex[jumpNode] = -1;
+				}
+				gScore[jumpNode] = gScoreNew;
+				fScore[jumpNode] = gScoreNew + fnHeuristic(jumpPoint);
+				cameFrom[jumpNode] = currentNode;
+				arrivalDirection[jumpNode] = direction;
+				if (heapIndex[jumpNode] >= 0)
+					HeapDecreaseKey(jumpNode);
+				else
+					HeapPush(jumpNode);
+			}
+		}
+
+		return path;
+	}
+
+	vector<ivec2> CalculatePath(const ivec2& start, const ivec2& goal, const ivec2& mapSize, const function<float(const glm::ivec2&)>& fnCost)
+	{
+		PathFinder pathFinder;
+		return pathFinder.CalculatePath(start, goal, mapSize, fnCost);
+	}
+}
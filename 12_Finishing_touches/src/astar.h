@@ -1,12 +1,65 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <vector>
 #include <glm/glm.hpp>
 
 #include <array2d.h>
+#include <bitarray2d.h>
 
 namespace rlf
 {
+	// A reusable A* search engine. All per-tile bookkeeping is stored in flat arrays sized to the map, and each tile is stamped with the
+	// generation (query counter) that last wrote to it, so that nothing needs to be cleared between queries. Keep one of these around per level
+	class PathFinder
+	{
+	public:
+		// Calculate a path given a start point, a goal point, the size of the map and a cost function (2d point -> cost), where a lower cost value is "easier to travel to"
+		std::vector<glm::ivec2> CalculatePath(const glm::ivec2& start, const glm::ivec2& goal, const glm::ivec2& mapSize, const std::function<float(const glm::ivec2&)>& fnCost);
+		// Calculate a path on a uniform-cost map, where each tile is either passable (cost 1) or blocked. The goal is allowed to be blocked, like above.
+		// This uses Jump Point Search: straight runs of open tiles are scanned without putting them in the frontier, and only the tiles where the path might turn are expanded
+		std::vector<glm::ivec2> CalculatePath(const glm::ivec2& start, const glm::ivec2& goal, const BitArray2D& blocked);
+
+	private:
+		// Make sure the scratch arrays match the map size, and start a new generation
+		void BeginQuery(const glm::ivec2& mapSize);
+		// Was this tile written to during the current query?
+		bool IsVisited(int node) const { return visitGeneration[node] == generation; }
+
+		// Indexed binary min-heap on the f-score. heapIndex stores where each tile is in the heap (-1 if not in the heap), so that we can decrease its key
+		void HeapPush(int node);
+		int HeapPop();
+		void HeapDecreaseKey(int node);
+		void HeapSiftUp(int heapPos);
+		void HeapSiftDown(int heapPos);
+		bool HeapLess(int nodeA, int nodeB) const;
+		void HeapSwap(int heapPosA, int heapPosB);
+
+	private:
+		// the map size that the scratch arrays are allocated for
+		glm::ivec2 mapSize = { 0,0 };
+		// the current query counter. A tile's data is only valid if visitGeneration[tile] == generation
+		uint32_t generation = 0;
+
+		// per-tile data, indexed by x + y * mapSize.x
+		std::vector<uint32_t> visitGeneration;
+		// accumulated path cost from start
+		std::vector<float> gScore;
+		// gScore + heuristic
+		std::vector<float> fScore;
+		// the tile we came from, for the recorded g-score
+		std::vector<int> cameFrom;
+		// jump point search only: the direction we came from
+		std::vector<glm::ivec2> arrivalDirection;
+		// position in the heap, or -1 if the tile is not in the heap
+		std::vector<int> heapIndex;
+
+		// the frontier: tile indices, ordered as a binary heap
+		std::vector<int> heap;
+	};
+
 	// Calculate a path given a start point, a goal point, the size of the map and a cost function (2d point -> cost), where a lower cost value is "easier to travel to"
+	// This uses a temporary PathFinder; prefer keeping a PathFinder around if you need to run many queries
 	std::vector<glm::ivec2> CalculatePath(const glm::ivec2& start, const glm::ivec2& goal, const glm::ivec2& mapSize, const std::function<float(const glm::ivec2&)>& fnCost);
-}
\ No newline at end of file
+}
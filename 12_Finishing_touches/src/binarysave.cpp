@@ -0,0 +1,657 @@
+#include "binarysave.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "game.h"
+#include "entity.h"
+#include "entitypool.h"
+#include "level.h"
+#include "rng.h"
+#include "db.h"
+
+namespace rlf
+{
+	// the first bytes of a binary save, uncompressed and compressed. Json saves start with '{', so they can't be confused
+	static const char MAGIC[4] = { 'R', 'L', 'F', 'S' };
+	static const char MAGIC_COMPRESSED[4] = { 'R', 'L', 'F', 'Z' };
+
+	// make a section tag out of 4 characters, so that the tags are readable in a hex editor
+	static constexpr uint32_t SectionTag(const char(&name)[5])
+	{
+		return uint32_t(uint8_t(name[0])) | (uint32_t(uint8_t(name[1])) << 8) | (uint32_t(uint8_t(name[2])) << 16) | (uint32_t(uint8_t(name[3])) << 24);
+	}
+	static constexpr uint32_t TAG_GAME = SectionTag("GAME");
+	static constexpr uint32_t TAG_NAMES = SectionTag("NAME");
+	static constexpr uint32_t TAG_ENTITIES = SectionTag("ENTS");
+	static constexpr uint32_t TAG_LEVEL = SectionTag("LEVL");
+	static constexpr uint32_t TAG_MESSAGE_LOG = SectionTag("MLOG");
+
+	// bits for the components that an entity has, in the entity's component mask
+	enum ComponentBits : uint8_t
+	{
+		HasInventory = 1 << 0,
+		HasCreatureData = 1 << 1,
+		HasObjectData = 1 << 2,
+		HasItemData = 1 << 3
+	};
+
+	void BinaryWriter::WriteU16(uint16_t value)
+	{
+		WriteU8(uint8_t(value));
+		WriteU8(uint8_t(value >> 8));
+	}
+
+	void BinaryWriter::WriteU32(uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i)
+			WriteU8(uint8_t(value >> (8 * i)));
+	}
+
+	void BinaryWriter::WriteU64(uint64_t value)
+	{
+		for (int i = 0; i < 8; ++i)
+			WriteU8(uint8_t(value >> (8 * i)));
+	}
+
+	void BinaryWriter::WriteFloat(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		WriteU32(bits);
+	}
+
+	void BinaryWriter::WriteVarUint(uint64_t value)
+	{
+		// 7 bits at a time, with the high bit set if more bytes follow
+		while (value >= 0x80)
+		{
+			WriteU8(uint8_t(value | 0x80));
+			value >>= 7;
+		}
+		WriteU8(uint8_t(value));
+	}
+
+	void BinaryWriter::WriteString(const std::string& value)
+	{
+		WriteVarUint(value.size());
+		buffer.append(value);
+	}
+
+	size_t BinaryWriter::BeginSection(uint32_t tag)
+	{
+		WriteU32(tag);
+		auto sectionStart = buffer.size();
+		// placeholder for the size
+		WriteU32(0);
+		return sectionStart;
+	}
+
+	void BinaryWriter::EndSection(size_t sectionStart)
+	{
+		auto sectionSize = uint32_t(buffer.size() - sectionStart - 4);
+		for (int i = 0; i < 4; ++i)
+			buffer[sectionStart + i] = char(uint8_t(sectionSize >> (8 * i)));
+	}
+
+	bool BinaryReader::Require(size_t numBytes)
+	{
+		if (!failed && size - pos >= numBytes)
+			return true;
+		failed = true;
+		return false;
+	}
+
+	uint8_t BinaryReader::ReadU8()
+	{
+		return Require(1) ? uint8_t(data[pos++]) : 0;
+	}
+
+	uint16_t BinaryReader::ReadU16()
+	{
+		uint16_t value = ReadU8();
+		return uint16_t(value | (uint16_t(ReadU8()) << 8));
+	}
+
+	uint32_t BinaryReader::ReadU32()
+	{
+		uint32_t value = 0;
+		for (int i = 0; i < 4; ++i)
+			value |= uint32_t(ReadU8()) << (8 * i);
+		return value;
+	}
+
+	uint64_t BinaryReader::ReadU64()
+	{
+		uint64_t value = 0;
+		for (int i = 0; i < 8; ++i)
+			value |= uint64_t(ReadU8()) << (8 * i);
+		return value;
+	}
+
+	float BinaryReader::ReadFloat()
+	{
+		auto bits = ReadU32();
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	uint64_t BinaryReader::ReadVarUint()
+	{
+		uint64_t value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			auto byte = ReadU8();
+			value |= uint64_t(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+				return value;
+		}
+		// too many bytes for a 64-bit value
+		Fail();
+		return 0;
+	}
+
+	std::string BinaryReader::ReadString()
+	{
+		auto length = ReadVarUint();
+		if (!Require(length))
+			return {};
+		std::string value(data + pos, size_t(length));
+		pos += size_t(length);
+		return value;
+	}
+
+	BinaryReader BinaryReader::ReadSection(uint32_t& tag)
+	{
+		tag = ReadU32();
+		auto sectionSize = ReadU32();
+		if (!Require(sectionSize))
+		{
+			BinaryReader section(nullptr, 0);
+			section.Fail();
+			return section;
+		}
+		BinaryReader section(data + pos, sectionSize);
+		pos += sectionSize;
+		return section;
+	}
+
+	bool BinarySave::IsBinarySave(const std::string& data)
+	{
+		return data.size() >= sizeof(MAGIC) && (std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) == 0 || std::memcmp(data.data(), MAGIC_COMPRESSED, sizeof(MAGIC)) == 0);
+	}
+
+	std::string BinarySave::Compress(const std::string& data)
+	{
+		BinaryWriter writer;
+		for (auto c : MAGIC_COMPRESSED)
+			writer.WriteU8(uint8_t(c));
+		writer.WriteVarUint(data.size());
+
+		// PackBits: a control byte n, followed by n+1 literal bytes if n < 128, or by a single byte that is repeated 257-n times if n > 128
+		std::string output = writer.Buffer();
+		output.reserve(output.size() + data.size() / 2);
+		size_t i = 0;
+		while (i < data.size())
+		{
+			// measure the run starting here
+			size_t runEnd = i + 1;
+			while (runEnd < data.size() && runEnd - i < 128 && data[runEnd] == data[i])
+				++runEnd;
+			if (runEnd - i >= 3)
+			{
+				output.push_back(char(uint8_t(257 - (runEnd - i))));
+				output.push_back(data[i]);
+				i = runEnd;
+				continue;
+			}
+			// otherwise gather literals until the next run of 3 or more
+			size_t literalEnd = i;
+			while (literalEnd < data.size() && literalEnd - i < 128)
+			{
+				if (literalEnd + 2 < data.size() && data[literalEnd] == data[literalEnd + 1] && data[literalEnd] == data[literalEnd + 2])
+					break;
+				++literalEnd;
+			}
+			output.push_back(char(uint8_t(literalEnd - i - 1)));
+			output.append(data, i, literalEnd - i);
+			i = literalEnd;
+		}
+		return output;
+	}
+
+	std::string BinarySave::Decompress(const std::string& data)
+	{
+		if (data.size() < sizeof(MAGIC_COMPRESSED) || std::memcmp(data.data(), MAGIC_COMPRESSED, sizeof(MAGIC_COMPRESSED)) != 0)
+			return {};
+		BinaryReader reader(data.data() + sizeof(MAGIC_COMPRESSED), data.size() - sizeof(MAGIC_COMPRESSED));
+		auto size = reader.ReadVarUint();
+		// the compressed data can't expand more than 128 times
+		if (reader.Failed() || size > data.size() * 128)
+			return {};
+
+		std::string output;
+		output.reserve(size_t(size));
+		while (!reader.AtEnd() && output.size() < size)
+		{
+			auto control = reader.ReadU8();
+			if (control < 128)
+			{
+				for (int i = 0; i <= control; ++i)
+					output.push_back(char(reader.ReadU8()));
+			}
+			else if (control > 128)
+				output.append(257 - control, char(reader.ReadU8()));
+		}
+		if (reader.Failed() || output.size() != size)
+			return {};
+		return output;
+	}
+
+	void BinarySave::WriteEntityId(BinaryWriter& writer, const EntityId& id)
+	{
+		writer.WriteVarInt(id.id);
+		writer.WriteVarInt(id.version);
+	}
+
+	EntityId BinarySave::ReadEntityId(BinaryReader& reader)
+	{
+		EntityId id;
+		id.id = int(reader.ReadVarInt());
+		id.version = int(reader.ReadVarInt());
+		return id;
+	}
+
+	void BinarySave::WriteRng(BinaryWriter& writer, const Rng& rng)
+	{
+		writer.WriteU64(rng.state);
+		writer.WriteU64(rng.increment);
+	}
+
+	void BinarySave::ReadRng(BinaryReader& reader, Rng& rng)
+	{
+		rng.state = reader.ReadU64();
+		rng.increment = reader.ReadU64();
+	}
+
+	void BinarySave::WriteEntities(BinaryWriter& writer, const EntityPool& pool, const std::vector<int>& dbIndexToName)
+	{
+		auto freeSlots = pool.FreeSlots();
+		writer.WriteVarUint(freeSlots.size());
+		for (auto slot : freeSlots)
+			writer.WriteVarUint(slot);
+
+		writer.WriteVarUint(pool.Size());
+		for (int slot = 0; slot < pool.Size(); ++slot)
+		{
+			const auto& entity = *pool.GetSlot(slot);
+			const auto* inventory = pool.Inventories().Get(slot);
+			const auto* creatureData = pool.Creatures().Get(slot);
+			const auto* objectData = pool.Objects().Get(slot);
+			const auto* itemData = pool.Items().Get(slot);
+
+			// the slot is implied by the order, so only the version is stored
+			writer.WriteVarInt(entity.id.version);
+			// name table index plus one, so that 0 is an invalid db index
+			auto dbIndex = entity.dbIndex.index;
+			writer.WriteVarUint(dbIndex >= 0 ? dbIndexToName[dbIndex] + 1 : 0);
+			writer.WriteString(entity.name);
+			writer.WriteVarUint(uint32_t(entity.type));
+			writer.WriteVarInt(entity.location.levelId);
+			writer.WriteVarInt(entity.location.position.x);
+			writer.WriteVarInt(entity.location.position.y);
+
+			uint8_t components = (inventory != nullptr ? HasInventory : 0) | (creatureData != nullptr ? HasCreatureData : 0)
+				| (objectData != nullptr ? HasObjectData : 0) | (itemData != nullptr ? HasItemData : 0);
+			writer.WriteU8(components);
+			if (inventory != nullptr)
+			{
+				writer.WriteVarUint(inventory->items.size());
+				for (const auto& itemId : inventory->items)
+					WriteEntityId(writer, itemId);
+			}
+			if (creatureData != nullptr)
+			{
+				writer.WriteVarInt(creatureData->hp);
+				writer.WriteVarInt(creatureData->xp);
+			}
+			if (objectData != nullptr)
+			{
+				writer.WriteVarInt(objectData->state);
+				writer.WriteBool(objectData->blocksMovement);
+				writer.WriteBool(objectData->blocksVision);
+			}
+			if (itemData != nullptr)
+			{
+				writer.WriteVarInt(itemData->stackSize);
+				WriteEntityId(writer, itemData->owner);
+				writer.WriteBool(itemData->equipped);
+			}
+		}
+	}
+
+	void BinarySave::ReadEntities(BinaryReader& reader, SaveData& save, const std::vector<DbIndex>& names)
+	{
+		auto numFreeSlots = reader.ReadVarUint();
+		for (uint64_t i = 0; i < numFreeSlots && !reader.Failed(); ++i)
+			save.invalidPoolIndices.insert(int(reader.ReadVarUint()));
+
+		auto& pool = save.poolEntities;
+		pool.Clear();
+		auto numSlots = int(reader.ReadVarUint());
+		for (int slot = 0; slot < numSlots && !reader.Failed(); ++slot)
+		{
+			auto version = int(reader.ReadVarInt());
+			auto& entity = pool.RestoreSlot(slot, version);
+			entity.id = { slot, version };
+			auto nameIndex = reader.ReadVarUint();
+			if (nameIndex > names.size())
+				reader.Fail();
+			else
+				entity.dbIndex = nameIndex > 0 ? names[nameIndex - 1] : DbIndex();
+			entity.name = reader.ReadString();
+			entity.type = EntityType(uint32_t(reader.ReadVarUint()));
+			entity.location.levelId = int(reader.ReadVarInt());
+			entity.location.position.x = int(reader.ReadVarInt());
+			entity.location.position.y = int(reader.ReadVarInt());
+
+			auto components = reader.ReadU8();
+			if (components & HasInventory)
+			{
+				auto& inventory = pool.Inventories().Add(slot);
+				auto numItems = reader.ReadVarUint();
+				for (uint64_t i = 0; i < numItems && !reader.Failed(); ++i)
+					inventory.items.push_back(ReadEntityId(reader));
+			}
+			if (components & HasCreatureData)
+			{
+				auto& creatureData = pool.Creatures().Add(slot);
+				creatureData.hp = int(reader.ReadVarInt());
+				creatureData.xp = int(reader.ReadVarInt());
+			}
+			if (components & HasObjectData)
+			{
+				auto& objectData = pool.Objects().Add(slot);
+				objectData.state = int(reader.ReadVarInt());
+				objectData.blocksMovement = reader.ReadBool();
+				objectData.blocksVision = reader.ReadBool();
+			}
+			if (components & HasItemData)
+			{
+				auto& itemData = pool.Items().Add(slot);
+				itemData.stackSize = int(reader.ReadVarInt());
+				itemData.owner = ReadEntityId(reader);
+				itemData.equipped = reader.ReadBool();
+			}
+		}
+		for (auto slot : save.invalidPoolIndices)
+			if (slot < 0 || slot >= numSlots)
+				reader.Fail();
+	}
+
+	// bg elements don't have an identifier, so they're compared by value when building the palette
+	static bool SameBgElement(const LevelBgElement& a, const LevelBgElement& b)
+	{
+		return a.name == b.name && a.blocksVision == b.blocksVision && a.blocksMovement == b.blocksMovement && a.isLiquid == b.isLiquid && a.glyph == b.glyph && a.color == b.color;
+	}
+
+	void BinarySave::WriteLevel(BinaryWriter& writer, const Level& level)
+	{
+		auto size = level.bg.Size();
+		writer.WriteVarInt(size.x);
+		writer.WriteVarInt(size.y);
+
+		// build the palette and the palette index of each tile. Levels only use a handful of unique elements, and neighbouring tiles are often the same
+		std::vector<LevelBgElement> palette;
+		std::vector<uint16_t> tiles;
+		tiles.reserve(level.bg.Data().size());
+		for (const auto& element : level.bg.Data())
+		{
+			if (tiles.empty() || !SameBgElement(element, palette[tiles.back()]))
+			{
+				auto it = std::find_if(palette.begin(), palette.end(), [&element](const LevelBgElement& e) { return SameBgElement(e, element); });
+				if (it == palette.end())
+					it = palette.insert(palette.end(), element);
+				tiles.push_back(uint16_t(it - palette.begin()));
+			}
+			else
+				tiles.push_back(tiles.back());
+		}
+
+		writer.WriteVarUint(palette.size());
+		for (const auto& element : palette)
+		{
+			writer.WriteString(element.name);
+			writer.WriteBool(element.blocksVision);
+			writer.WriteBool(element.blocksMovement);
+			writer.WriteBool(element.isLiquid);
+			writer.WriteU8(uint8_t(element.glyph));
+			for (int i = 0; i < 4; ++i)
+				writer.WriteFloat(element.color[i]);
+		}
+		// one byte per tile, unless there are too many palette entries
+		auto isWide = palette.size() > 256;
+		for (auto tile : tiles)
+		{
+			if (isWide)
+				writer.WriteU16(tile);
+			else
+				writer.WriteU8(uint8_t(tile));
+		}
+
+		for (auto status : level.fogOfWar.Data())
+			writer.WriteU8(uint8_t(status));
+
+		writer.WriteVarUint(level.entities.size());
+		for (const auto& entityId : level.entities)
+			WriteEntityId(writer, entityId);
+	}
+
+	void BinarySave::ReadLevel(BinaryReader& reader, Level& level)
+	{
+		// read the dimensions at full width, so that out of range values are rejected rather than truncated
+		auto sizeX = reader.ReadVarInt();
+		auto sizeY = reader.ReadVarInt();
+		if (sizeX < 0 || sizeY < 0 || sizeX > std::numeric_limits<int>::max() || sizeY > std::numeric_limits<int>::max())
+		{
+			reader.Fail();
+			return;
+		}
+		const glm::ivec2 size = { int(sizeX), int(sizeY) };
+
+		auto paletteSize = reader.ReadVarUint();
+		if (paletteSize > 65536)
+			reader.Fail();
+		std::vector<LevelBgElement> palette;
+		for (uint64_t i = 0; i < paletteSize && !reader.Failed(); ++i)
+		{
+			LevelBgElement element;
+			element.name = reader.ReadString();
+			element.blocksVision = reader.ReadBool();
+			element.blocksMovement = reader.ReadBool();
+			element.isLiquid = reader.ReadBool();
+			element.glyph = char(reader.ReadU8());
+			for (int j = 0; j < 4; ++j)
+				element.color[j] = reader.ReadFloat();
+			palette.push_back(element);
+		}
+		if (reader.Failed())
+			return;
+
+		// both dimensions fit in an int, so the product can't overflow 64 bits. Each tile takes a palette index and a fog of war byte,
+		//	  so a corrupt size is rejected here, before allocating for it
+		auto numTiles = uint64_t(sizeX) * uint64_t(sizeY);
+		auto isWide = palette.size() > 256;
+		const uint64_t bytesPerTile = isWide ? 3 : 2;
+		if (numTiles > reader.Remaining() / bytesPerTile)
+		{
+			reader.Fail();
+			return;
+		}
+		std::vector<LevelBgElement> bg;
+		bg.reserve(size_t(numTiles));
+		for (uint64_t i = 0; i < numTiles && !reader.Failed(); ++i)
+		{
+			auto tile = isWide ? reader.ReadU16() : reader.ReadU8();
+			if (size_t(tile) >= palette.size())
+			{
+				reader.Fail();
+				return;
+			}
+			bg.push_back(palette[tile]);
+		}
+
+		std::vector<FogOfWarStatus> fogOfWar;
+		fogOfWar.reserve(size_t(numTiles));
+		for (uint64_t i = 0; i < numTiles && !reader.Failed(); ++i)
+		{
+			auto fog = reader.ReadU8();
+			if (fog > uint8_t(FogOfWarStatus::Visible))
+			{
+				reader.Fail();
+				return;
+			}
+			fogOfWar.push_back(FogOfWarStatus(fog));
+		}
+
+		level.entities.clear();
+		auto numEntities = reader.ReadVarUint();
+		for (uint64_t i = 0; i < numEntities && !reader.Failed(); ++i)
+			level.entities.push_back(ReadEntityId(reader));
+
+		if (reader.Failed())
+			return;
+		level.bg = Array2D<LevelBgElement>(size, bg);
+		level.fogOfWar = Array2D<FogOfWarStatus>(size, fogOfWar);
+	}
+
+	std::string BinarySave::Write(const SaveData& save)
+	{
+		BinaryWriter writer;
+		for (auto c : MAGIC)
+			writer.WriteU8(uint8_t(c));
+		writer.WriteU32(VERSION);
+
+		auto section = writer.BeginSection(TAG_GAME);
+		writer.WriteVarInt(save.currentLevelIndex);
+		WriteEntityId(writer, save.playerId);
+		writer.WriteU64(save.seed);
+		writer.WriteVarUint(save.rngStreams.size());
+		for (const auto& rng : save.rngStreams)
+			WriteRng(writer, rng);
+		writer.EndSection(section);
+
+		// the names of the database entries that are used, in order of first use. Entities refer to them by their index in this table
+		std::vector<int> dbIndexToName(Db::Instance().Size(), -1);
+		std::vector<int> usedDbIndices;
+		const auto& pool = save.poolEntities;
+		for (int slot = 0; slot < pool.Size(); ++slot)
+		{
+			auto dbIndex = pool.GetSlot(slot)->DbCfg().index;
+			if (dbIndex >= 0 && dbIndexToName[dbIndex] < 0)
+			{
+				dbIndexToName[dbIndex] = int(usedDbIndices.size());
+				usedDbIndices.push_back(dbIndex);
+			}
+		}
+		section = writer.BeginSection(TAG_NAMES);
+		writer.WriteVarUint(usedDbIndices.size());
+		for (auto dbIndex : usedDbIndices)
+			writer.WriteString(DbIndex::FromIndex(dbIndex).Name());
+		writer.EndSection(section);
+
+		section = writer.BeginSection(TAG_ENTITIES);
+		WriteEntities(writer, pool, dbIndexToName);
+		writer.EndSection(section);
+
+		for (const auto& level : save.levels)
+		{
+			section = writer.BeginSection(TAG_LEVEL);
+			WriteLevel(writer, level);
+			writer.EndSection(section);
+		}
+
+		section = writer.BeginSection(TAG_MESSAGE_LOG);
+		writer.WriteVarUint(save.messageLog.size());
+		for (const auto& [message, count] : save.messageLog)
+		{
+			writer.WriteString(message);
+			writer.WriteVarUint(count);
+		}
+		writer.EndSection(section);
+		return writer.Buffer();
+	}
+
+	bool BinarySave::Read(const std::string& data, SaveData& save)
+	{
+		if (!IsBinarySave(data))
+			return false;
+		if (std::memcmp(data.data(), MAGIC_COMPRESSED, sizeof(MAGIC_COMPRESSED)) == 0)
+		{
+			auto decompressed = Decompress(data);
+			return !decompressed.empty() && Read(decompressed, save);
+		}
+		BinaryReader reader(data.data() + sizeof(MAGIC), data.size() - sizeof(MAGIC));
+		auto version = reader.ReadU32();
+		if (version > VERSION)
+			return false;
+
+		std::vector<DbIndex> names;
+		while (!reader.AtEnd() && !reader.Failed())
+		{
+			uint32_t tag = 0;
+			auto section = reader.ReadSection(tag);
+			switch (tag)
+			{
+			case TAG_GAME:
+			{
+				save.currentLevelIndex = int(section.ReadVarInt());
+				save.playerId = ReadEntityId(section);
+				save.seed = section.ReadU64();
+				auto numStreams = section.ReadVarUint();
+				for (uint64_t i = 0; i < numStreams && !section.Failed(); ++i)
+				{
+					// streams that were added later keep their default state
+					Rng rng;
+					ReadRng(section, rng);
+					if (i < save.rngStreams.size())
+						save.rngStreams[i] = rng;
+				}
+				break;
+			}
+			case TAG_NAMES:
+			{
+				auto numNames = section.ReadVarUint();
+				for (uint64_t i = 0; i < numNames && !section.Failed(); ++i)
+					names.push_back(DbIndex(section.ReadString()));
+				break;
+			}
+			case TAG_ENTITIES:
+				ReadEntities(section, save, names);
+				break;
+			case TAG_LEVEL:
+				save.levels.emplace_back();
+				ReadLevel(section, save.levels.back());
+				break;
+			case TAG_MESSAGE_LOG:
+			{
+				auto numMessages = section.ReadVarUint();
+				for (uint64_t i = 0; i < numMessages && !section.Failed(); ++i)
+				{
+					auto message = section.ReadString();
+					save.messageLog.emplace_back(message, int(section.ReadVarUint()));
+				}
+				break;
+			}
+			default:
+				// unknown section, from a newer version of the same format
+				break;
+			}
+			if (section.Failed())
+				return false;
+		}
+		return !reader.Failed() && save.currentLevelIndex >= 0 && save.currentLevelIndex < int(save.levels.size());
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rlf
+{
+	class Level;
+	class EntityPool;
+	class Rng;
+	struct SaveData;
+	struct EntityId;
+	struct DbIndex;
+
+	// Appends binary data to a byte buffer. Fixed-width values are little-endian; most integers are small, so they are stored as variable-length values (LEB128)
+	class BinaryWriter
+	{
+	public:
+		void WriteU8(uint8_t value) { buffer.push_back(char(value)); }
+		void WriteU16(uint16_t value);
+		void WriteU32(uint32_t value);
+		void WriteU64(uint64_t value);
+		void WriteFloat(float value);
+		void WriteBool(bool value) { WriteU8(value ? 1 : 0); }
+		// variable-length integers. Signed ones are zigzag-encoded, so that small negative values stay small
+		void WriteVarUint(uint64_t value);
+		void WriteVarInt(int64_t value) { WriteVarUint((uint64_t(value) << 1) ^ uint64_t(value >> 63)); }
+		// a string, prefixed by its length
+		void WriteString(const std::string& value);
+
+		// Start a section with a tag, and return where it starts. The section size is filled in when the section is ended
+		size_t BeginSection(uint32_t tag);
+		void EndSection(size_t sectionStart);
+
+		const std::string& Buffer() const { return buffer; }
+
+	private:
+		std::string buffer;
+	};
+
+	// Reads binary data written by BinaryWriter. Reading past the end marks the reader as failed, and returns zeros from then on
+	class BinaryReader
+	{
+	public:
+		BinaryReader(const char* data, size_t size) :data(data), size(size) {}
+
+		uint8_t ReadU8();
+		uint16_t ReadU16();
+		uint32_t ReadU32();
+		uint64_t ReadU64();
+		float ReadFloat();
+		bool ReadBool() { return ReadU8() != 0; }
+		uint64_t ReadVarUint();
+		int64_t ReadVarInt() { auto value = ReadVarUint(); return int64_t(value >> 1) ^ -int64_t(value & 1); }
+		std::string ReadString();
+
+		// Read a section tag and size, and return a reader for the section contents. This reader moves past the section
+		BinaryReader ReadSection(uint32_t& tag);
+
+		// Mark the data as invalid, e.g. when a value is out of range
+		void Fail() { failed = true; }
+		bool Failed() const { return failed; }
+		bool AtEnd() const { return pos >= size; }
+		// The number of bytes left to read, to check sizes read from the data before allocating anything
+		size_t Remaining() const { return pos < size ? size - pos : 0; }
+
+	private:
+		// check that there are enough bytes left to read, and fail otherwise
+		bool Require(size_t numBytes);
+
+		const char* data;
+		size_t size;
+		size_t pos = 0;
+		bool failed = false;
+	};
+
+	// The binary savegame format. It's much smaller and faster than json: entities are streamed straight from the pool, and tiles are stored as indices to a palette of unique bg elements
+	// Layout: the magic bytes and the format version, followed by sections. Each section is a tag and the size of its contents, so readers can skip unknown sections
+	//	GAME: current level index, player id, seed and random number streams
+	//	NAME: the database entries that the entities use, by name, as indices depend on the order of loading
+	//	ENTS: the free slots, then every slot of the entity pool with its components
+	//	LEVL: one per level, in order: size, palette of bg elements, palette index per tile, fog of war and entity list
+	//	MLOG: the message log
+	// Saves written to disk are compressed with run-length encoding (PackBits), which works well for the long runs of identical tiles and fog of war, and are marked with different magic bytes
+	// A class, so that it can be a friend of the types with private data that it stores
+	class BinarySave
+	{
+	public:
+		// Increment when the layout changes. Older versions can still be read, as long as we keep the code for them
+		static constexpr uint32_t VERSION = 1;
+
+		// Check if some file data is a binary save (rather than json), compressed or not
+		static bool IsBinarySave(const std::string& data);
+		// Convert a save to binary
+		static std::string Write(const SaveData& save);
+		// Read a save from binary data, compressed or not. Return false if the data is invalid or from a newer version
+		static bool Read(const std::string& data, SaveData& save);
+
+		// Compress/decompress binary save data. Decompressing returns an empty string if the data is invalid
+		static std::string Compress(const std::string& data);
+		static std::string Decompress(const std::string& data);
+
+	private:
+		static void WriteEntityId(BinaryWriter& writer, const EntityId& id);
+		static EntityId ReadEntityId(BinaryReader& reader);
+		static void WriteRng(BinaryWriter& writer, const Rng& rng);
+		static void ReadRng(BinaryReader& reader, Rng& rng);
+		static void WriteEntities(BinaryWriter& writer, const EntityPool& pool, const std::vector<int>& dbIndexToName);
+		static void ReadEntities(BinaryReader& reader, SaveData& save, const std::vector<DbIndex>& names);
+		static void WriteLevel(BinaryWriter& writer, const Level& level);
+		static void ReadLevel(BinaryReader& reader, Level& level);
+	};
+}
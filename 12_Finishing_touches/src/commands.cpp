@@ -4,7 +4,6 @@
 
 #include "game.h"
 #include "entity.h"
-#include "graphics.h"
 #include "signals.h"
 
 using namespace glm;
@@ -174,8 +173,9 @@ namespace rlf
 		auto defenderStats = AccumulateCombatStats(defender);
 		// check if attack lands!
 		std::string text = fmt::format("{0} attacks {1}. ", attacker.Name(), defender.Name());
-		auto attRoll = rand() % max(attackerStats[int(CombatStat::Attack)],1);
-		auto defRoll = rand() % max(defenderStats[int(CombatStat::Defense)],1);
+		auto& rng = g.GetRng(RngStream::Combat);
+		auto attRoll = rng.Below(max(attackerStats[int(CombatStat::Attack)],1));
+		auto defRoll = rng.Below(max(defenderStats[int(CombatStat::Defense)],1));
 		text += fmt::format("{0}(d{1}) vs {2}(d{3}): ", attRoll + 1, attackerStats[int(CombatStat::Attack)], defRoll + 1, defenderStats[int(CombatStat::Defense)]);
 		if (defRoll < attRoll) // does the attack land?
 		{
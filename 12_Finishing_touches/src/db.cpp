@@ -38,6 +38,34 @@ namespace rlf
 		return cfg;
 	}
 
+	const EntityConfig* Db::Get(int index) const
+	{
+		assert(IsOwnerThread());
+		return (index >= 0 && index < int(configs.size()) && isDefined[index]) ? &configs[index] : nullptr;
+	}
+
+	int Db::Intern(const std::string& name)
+	{
+		// this can reallocate the storage, so it must never run while another thread reads the database
+		assert(IsOwnerThread());
+		auto it = nameToIndex.find(name);
+		if (it != nameToIndex.end())
+			return it->second;
+		int index = int(names.size());
+		nameToIndex.emplace(name, index);
+		names.push_back(name);
+		configs.emplace_back();
+		isDefined.push_back(false);
+		return index;
+	}
+
+	void Db::Add(const std::string& name, EntityConfig& cfg)
+	{
+		auto index = Intern(name);
+		configs[index] = std::move(cfg);
+		isDefined[index] = true;
+	}
+
 	void Db::LoadFromCode()
 	{
 		Add("player", MakeCreature(
@@ -1,56 +1,80 @@
 #pragma once
 
+#include <cassert>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace rlf
 {
 	class EntityConfig;
 
 	// A class that stores our configuration database, for spawning entities
+	// Configuration names are interned: each name gets a dense integer index, and configurations are stored contiguously by index
+	// Interning a name can grow the storage at any time (e.g. when loading a save), so the database is not thread-safe: only the thread that created it may use it.
+	// Background work gets what it needs from the database beforehand
 	class Db
 	{
 	public:
 
 		static Db& Instance() { static Db instance; return instance; }
 
-		// Load the database from a .json file
+		// Load the database from a .json file. Existing configurations are updated in place, so that their indices stay the same
 		void LoadFromDisk();
 		// Load the database from code (hard-code configurations)
 		void LoadFromCode();
 
-		// Get a configuration given a name. Return nullptr if name was not found
-		const EntityConfig * Get(const std::string& name) const { return &db.at(name); }
-		// Add a configuration dynamically
-		void Add(const std::string& name, EntityConfig& cfg) { db.emplace(name, std::move(cfg)); }
-		// Return the map of names -> configurations
-		const std::unordered_map<std::string, EntityConfig>& All() const  { return db; }
+		// Get a configuration given an index. Return nullptr if there's no configuration for that index
+		const EntityConfig * Get(int index) const;
+		// Add a configuration dynamically, or replace an existing one with the same name
+		void Add(const std::string& name, EntityConfig& cfg);
+		// Get the index for a name, allocating a new one (without a configuration) if we haven't seen that name before
+		int Intern(const std::string& name);
+		// Get the name for an index
+		const std::string& Name(int index) const { assert(IsOwnerThread()); return names.at(index); }
+		// Number of indices, including any that don't have a configuration
+		int Size() const { assert(IsOwnerThread()); return int(names.size()); }
 		
 	private:
-		// The map of names -> configurations
-		std::unordered_map<std::string, EntityConfig> db;
+		// Check that we're on the thread that owns the database
+		bool IsOwnerThread() const { return std::this_thread::get_id() == ownerThread; }
+
+	private:
+		// The thread that created the database, and the only one that may use it
+		std::thread::id ownerThread = std::this_thread::get_id();
+		// The configurations, names and whether the configuration has been defined, per index
+		std::vector<EntityConfig> configs;
+		std::vector<std::string> names;
+		std::vector<bool> isDefined;
+		// The map of names -> indices
+		std::unordered_map<std::string, int> nameToIndex;
 	};
 
-	// A struct that can be used to access an entity configuration using its name. 
+	// A handle that can be used to access an entity configuration. It's just an index into the database, so it's cheap to copy and compare
 	struct DbIndex
 	{
 		// Construct an invalid object
 		DbIndex() = default;
 		// Construct an object using the configuration name
-		DbIndex(const std::string& name) :name(name) {};
+		DbIndex(const std::string& name) :index(Db::Instance().Intern(name)) {};
+		// Construct an object from an index in the database
+		static DbIndex FromIndex(int index) { DbIndex dbIndex; dbIndex.index = index; return dbIndex; }
 		// Check if this object is valid 
-		bool IsValid() const  { return !name.empty() && Cfg() != nullptr; }
+		bool IsValid() const  { return index >= 0 && Cfg() != nullptr; }
 		// Get the configuration as a const pointer
-		const EntityConfig* Cfg() const { return Db::Instance().Get(name); }
+		const EntityConfig* Cfg() const { return Db::Instance().Get(index); }
+		// Get the configuration name
+		const std::string& Name() const { return Db::Instance().Name(index); }
 
-		bool operator == (const DbIndex& other) const  { return name == other.name; }
+		bool operator == (const DbIndex& other) const  { return index == other.index; }
 
 		// Special ones, they are expected to be in the database
-		static const DbIndex Door() { return DbIndex("door"); }
-		static const DbIndex StairsUp() { return DbIndex("stairs_up"); }
-		static const DbIndex StairsDown() { return DbIndex("stairs_down"); }
-		static const DbIndex ItemPile() { return DbIndex("item_pile"); }
+		static const DbIndex Door() { static const DbIndex door("door"); return door; }
+		static const DbIndex StairsUp() { static const DbIndex stairsUp("stairs_up"); return stairsUp; }
+		static const DbIndex StairsDown() { static const DbIndex stairsDown("stairs_down"); return stairsDown; }
+		static const DbIndex ItemPile() { static const DbIndex itemPile("item_pile"); return itemPile; }
 
-		std::string name;
+		int index = -1;
 	};
 }
\ No newline at end of file
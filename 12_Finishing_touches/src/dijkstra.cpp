@@ -0,0 +1,81 @@
+#include "dijkstra.h"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+#include "grid.h"
+
+using namespace glm;
+using namespace std;
+
+namespace rlf
+{
+	void DistanceMap::Calculate(const vector<ivec2>& goals, const ivec2& mapSize, const function<float(const ivec2&)>& fnCost)
+	{
+		// This means "impassable"
+		constexpr float INF_COST = std::numeric_limits<float>::infinity();
+
+		// reuse the old allocation if the size matches
+		if (distances.Size() == mapSize)
+		{
+			for (int y = 0; y < mapSize.y; ++y)
+				for (int x = 0; x < mapSize.x; ++x)
+					distances(x, y) = INF_COST;
+		}
+		else
+			distances = Array2D<float>(mapSize, INF_COST);
+
+		// The frontier, as (distance, tile) pairs. We don't bother with decrease-key here: if we find a better distance we push the tile again, and skip the stale entries when we pop them
+		using DistanceAndPoint = std::pair<float, ivec2>;
+		const auto fnGreater = [](const DistanceAndPoint& lhs, const DistanceAndPoint& rhs) { return lhs.first > rhs.first; };
+		priority_queue<DistanceAndPoint, vector<DistanceAndPoint>, decltype(fnGreater)> frontier(fnGreater);
+
+		// all goals start with a distance of zero
+		for (const auto& goal : goals)
+			if (distances.InBounds(goal))
+			{
+				distances(goal.x, goal.y) = 0.0f;
+				frontier.push({ 0.0f, goal });
+			}
+
+		while (!frontier.empty())
+		{
+			auto [distance, current] = frontier.top();
+			frontier.pop();
+			// skip stale entries
+			if (distance > distances(current.x, current.y))
+				continue;
+			for (const auto& nbOffset : Nb4())
+			{
+				auto nb = current + nbOffset;
+				if (!distances.InBounds(nb))
+					continue;
+				auto costNb = fnCost(nb);
+				if (costNb == INF_COST)
+					continue;
+				auto distanceNb = distance + costNb;
+				auto& distanceNbOld = distances(nb.x, nb.y);
+				if (distanceNb < distanceNbOld)
+				{
+					distanceNbOld = distanceNb;
+					frontier.push({ distanceNb, nb });
+				}
+			}
+		}
+	}
+
+	int DistanceMap::DownhillNeighbours(array<ivec2, 4>& neighbours, const ivec2& p) const
+	{
+		int numNeighbours = 0;
+		auto distance = Distance(p);
+		for (const auto& nbOffset : Nb4())
+		{
+			auto nb = p + nbOffset;
+			if (Distance(nb) < distance)
+				neighbours[numNeighbours++] = nb;
+		}
+		std::sort(neighbours.begin(), neighbours.begin() + numNeighbours, [this](const ivec2& lhs, const ivec2& rhs) { return Distance(lhs) < Distance(rhs); });
+		return numNeighbours;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include <array2d.h>
+
+namespace rlf
+{
+	// A distance field (also known as a "Dijkstra map"): for every tile, store the cost of the cheapest path to the closest of a set of goal tiles.
+	// Calculate it once, and then any number of entities can walk towards the goals by repeatedly stepping to the neighbour with the lowest distance
+	class DistanceMap
+	{
+	public:
+		// Calculate the distances to the given goals, given the size of the map and a cost function (2d point -> cost) for entering a tile.
+		// Goal tiles get a distance of 0, whatever their cost
+		void Calculate(const std::vector<glm::ivec2>& goals, const glm::ivec2& mapSize, const std::function<float(const glm::ivec2&)>& fnCost);
+
+		// Get the distance at a point. Infinity means unreachable (or out of the map)
+		float Distance(const glm::ivec2& p) const { return distances.InBounds(p) ? distances(p.x, p.y) : std::numeric_limits<float>::infinity(); }
+
+		// Get the 4-connected neighbours of a point that are closer to the goals than the point itself, sorted from best to worst, and return how many there are.
+		// There are at most 4, so a fixed-size array is enough and nothing gets allocated
+		int DownhillNeighbours(std::array<glm::ivec2, 4>& neighbours, const glm::ivec2& p) const;
+
+	private:
+		// the distance for each tile
+		Array2D<float> distances;
+	};
+}
@@ -0,0 +1,289 @@
+#include "dstarlite.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "grid.h"
+
+using namespace glm;
+using namespace std;
+
+namespace rlf
+{
+	// the distance of tiles that can't reach the root. Small enough that adding a step doesn't overflow
+	static constexpr int INF_DISTANCE = std::numeric_limits<int>::max() / 2;
+
+	int IncrementalPathFinder::Heuristic(int nodeA, int nodeB) const
+	{
+		// manhattan distance
+		auto v = abs(ToPoint(nodeA) - ToPoint(nodeB));
+		return v.x + v.y;
+	}
+
+	void IncrementalPathFinder::BeginSearch(const ivec2& root, const ivec2& goal)
+	{
+		// Start a new generation. If the counter wraps around, we need to clear the stamps once, as old ones could now look valid
+		if (++generation == 0)
+		{
+			std::fill(visitGeneration.begin(), visitGeneration.end(), 0);
+			generation = 1;
+		}
+		heap.resize(0);
+		changedTiles.clear();
+		rootNode = ToNode(root);
+		goalNode = ToNode(goal);
+		keyModifier = 0;
+		// the root is the only tile that starts inconsistent, at distance 0
+		Touch(rootNode);
+		rhsScore[rootNode] = 0;
+		HeapPush(rootNode, CalculateKey(rootNode));
+	}
+
+	void IncrementalPathFinder::Touch(int node)
+	{
+		if (visitGeneration[node] == generation)
+			return;
+		visitGeneration[node] = generation;
+		gScore[node] = INF_DISTANCE;
+		rhsScore[node] = INF_DISTANCE;
+		heapIndex[node] = -1;
+	}
+
+	IncrementalPathFinder::Key IncrementalPathFinder::CalculateKey(int node) const
+	{
+		auto distance = std::min(gScore[node], rhsScore[node]);
+		if (distance >= INF_DISTANCE)
+			return { INF_DISTANCE, INF_DISTANCE };
+		return { distance + Heuristic(node, goalNode) + keyModifier, distance };
+	}
+
+	void IncrementalPathFinder::UpdateNode(int node, const BitArray2D& blocked)
+	{
+		Touch(node);
+		if (node != rootNode)
+		{
+			// the best distance through an open neighbour. Blocked tiles can't be reached at all
+			int rhs = INF_DISTANCE;
+			auto p = ToPoint(node);
+			if (!blocked.Get(p))
+				for (const auto& nb : Nb4())
+				{
+					auto pnb = p + nb;
+					if (!blocked.InBounds(pnb))
+						continue;
+					auto nbNode = ToNode(pnb);
+					if (visitGeneration[nbNode] == generation && gScore[nbNode] < INF_DISTANCE)
+						rhs = std::min(rhs, gScore[nbNode] + 1);
+				}
+			rhsScore[node] = rhs;
+		}
+		// inconsistent tiles go in the frontier, consistent ones leave it
+		if (gScore[node] != rhsScore[node])
+		{
+			if (heapIndex[node] >= 0)
+				HeapUpdate(node, CalculateKey(node));
+			else
+				HeapPush(node, CalculateKey(node));
+		}
+		else if (heapIndex[node] >= 0)
+			HeapRemove(node);
+	}
+
+	void IncrementalPathFinder::ComputeShortestPath(const BitArray2D& blocked)
+	{
+		Touch(goalNode);
+		while (!heap.empty())
+		{
+			int node = heap[0];
+			auto oldKey = heapKey[node];
+			// stop once the goal is consistent and nothing in the frontier could still improve it
+			if (!(oldKey < CalculateKey(goalNode) || gScore[goalNode] != rhsScore[goalNode]))
+				break;
+			auto newKey = CalculateKey(node);
+			auto p = ToPoint(node);
+			if (oldKey < newKey)
+			{
+				// the key is out of date because the goal moved since the tile was added
+				HeapUpdate(node, newKey);
+			}
+			else if (gScore[node] > rhsScore[node])
+			{
+				// the tile got closer to the root: settle it and let the neighbours know
+				gScore[node] = rhsScore[node];
+				HeapRemove(node);
+				for (const auto& nb : Nb4())
+					if (blocked.InBounds(p + nb))
+						UpdateNode(ToNode(p + nb), blocked);
+			}
+			else
+			{
+				// the tile got further from the root (e.g. the way got blocked): reset it, and recalculate it and its neighbours
+				gScore[node] = INF_DISTANCE;
+				UpdateNode(node, blocked);
+				for (const auto& nb : Nb4())
+					if (blocked.InBounds(p + nb))
+						UpdateNode(ToNode(p + nb), blocked);
+			}
+		}
+	}
+
+	bool IncrementalPathFinder::ExtractPath(int startNode, const BitArray2D& blocked, vector<ivec2>& path) const
+	{
+		const auto start = ToPoint(startNode);
+		if (visitGeneration[startNode] != generation || gScore[startNode] >= gScore[goalNode])
+			return false;
+		const int startDistance = gScore[startNode];
+		path.resize(0);
+		int node = goalNode;
+		while (node != startNode)
+		{
+			path.push_back(ToPoint(node));
+			// step to a neighbour that is one tile closer to the root, and that could still be on a shortest path from the start
+			auto p = ToPoint(node);
+			int bestNode = -1;
+			int bestStartDistance = INF_DISTANCE;
+			for (const auto& nb : Nb4())
+			{
+				auto pnb = p + nb;
+				if (!blocked.InBounds(pnb) || blocked.Get(pnb))
+					continue;
+				auto nbNode = ToNode(pnb);
+				if (visitGeneration[nbNode] != generation || gScore[nbNode] != gScore[node] - 1)
+					continue;
+				auto v = abs(pnb - start);
+				auto nbStartDistance = v.x + v.y;
+				if (nbStartDistance <= gScore[nbNode] - startDistance && nbStartDistance < bestStartDistance)
+				{
+					bestNode = nbNode;
+					bestStartDistance = nbStartDistance;
+				}
+			}
+			if (bestNode < 0)
+				return false;
+			node = bestNode;
+		}
+		std::reverse(path.begin(), path.end());
+		return true;
+	}
+
+	vector<ivec2> IncrementalPathFinder::CalculatePath(const ivec2& start, const ivec2& goal, const BitArray2D& blocked)
+	{
+		if (start == goal || !blocked.InBounds(start) || !blocked.InBounds(goal) || blocked.Get(start) || blocked.Get(goal))
+			return {};
+
+		// (re)allocate the per-tile data only if the map size changed
+		if (blocked.Size() != mapSize)
+		{
+			mapSize = blocked.Size();
+			const auto numTiles = size_t(mapSize.x * mapSize.y);
+			visitGeneration.assign(numTiles, 0);
+			gScore.resize(numTiles);
+			rhsScore.resize(numTiles);
+			heapKey.resize(numTiles);
+			heapIndex.resize(numTiles);
+			generation = 0;
+			rootNode = -1;
+		}
+
+		if (rootNode < 0 || blocked.Get(ToPoint(rootNode)))
+			BeginSearch(start, goal);
+		else
+		{
+			// the goal moved: instead of recalculating all the keys, the heuristic change is added to the keys from now on
+			auto newGoalNode = ToNode(goal);
+			keyModifier += Heuristic(goalNode, newGoalNode);
+			goalNode = newGoalNode;
+			// a changed tile affects its own distance and its neighbours'
+			for (const auto& p : changedTiles)
+			{
+				UpdateNode(ToNode(p), blocked);
+				for (const auto& nb : Nb4())
+					if (blocked.InBounds(p + nb))
+						UpdateNode(ToNode(p + nb), blocked);
+			}
+			changedTiles.clear();
+		}
+
+		vector<ivec2> path;
+		ComputeShortestPath(blocked);
+		if (ExtractPath(ToNode(start), blocked, path))
+			return path;
+		// the start is not on the way from the root to the goal (or the goal is unreachable from the root), so search again from the start
+		if (rootNode != ToNode(start))
+		{
+			BeginSearch(start, goal);
+			ComputeShortestPath(blocked);
+			if (ExtractPath(ToNode(start), blocked, path))
+				return path;
+		}
+		return {};
+	}
+
+	void IncrementalPathFinder::HeapSwap(int heapPosA, int heapPosB)
+	{
+		std::swap(heap[heapPosA], heap[heapPosB]);
+		heapIndex[heap[heapPosA]] = heapPosA;
+		heapIndex[heap[heapPosB]] = heapPosB;
+	}
+
+	void IncrementalPathFinder::HeapSiftUp(int heapPos)
+	{
+		while (heapPos > 0)
+		{
+			int parentPos = (heapPos - 1) / 2;
+			if (!(heapKey[heap[heapPos]] < heapKey[heap[parentPos]]))
+				break;
+			HeapSwap(heapPos, parentPos);
+			heapPos = parentPos;
+		}
+	}
+
+	void IncrementalPathFinder::HeapSiftDown(int heapPos)
+	{
+		const int heapSize = int(heap.size());
+		while (true)
+		{
+			int bestPos = heapPos;
+			int leftPos = 2 * heapPos + 1;
+			int rightPos = leftPos + 1;
+			if (leftPos < heapSize && heapKey[heap[leftPos]] < heapKey[heap[bestPos]])
+				bestPos = leftPos;
+			if (rightPos < heapSize && heapKey[heap[rightPos]] < heapKey[heap[bestPos]])
+				bestPos = rightPos;
+			if (bestPos == heapPos)
+				break;
+			HeapSwap(heapPos, bestPos);
+			heapPos = bestPos;
+		}
+	}
+
+	void IncrementalPathFinder::HeapPush(int node, const Key& key)
+	{
+		heapKey[node] = key;
+		heapIndex[node] = int(heap.size());
+		heap.push_back(node);
+		HeapSiftUp(heapIndex[node]);
+	}
+
+	void IncrementalPathFinder::HeapRemove(int node)
+	{
+		// move the last element in the removed tile's place, and restore the heap property in whichever direction it's broken
+		int heapPos = heapIndex[node];
+		HeapSwap(heapPos, int(heap.size()) - 1);
+		heap.pop_back();
+		heapIndex[node] = -1;
+		if (heapPos < int(heap.size()))
+		{
+			int movedNode = heap[heapPos];
+			HeapSiftUp(heapPos);
+			HeapSiftDown(heapIndex[movedNode]);
+		}
+	}
+
+	void IncrementalPathFinder::HeapUpdate(int node, const Key& key)
+	{
+		heapKey[node] = key;
+		HeapSiftUp(heapIndex[node]);
+		HeapSiftDown(heapIndex[node]);
+	}
+}
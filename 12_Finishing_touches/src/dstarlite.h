@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include <bitarray2d.h>
+
+namespace rlf
+{
+	// An incremental pathfinder (D* Lite) for an entity that keeps chasing a moving target on a uniform-cost map.
+	// The search is rooted where the entity was when it started following the target, and it grows towards the target. Between queries the search state is kept:
+	// when the target moves, the search only continues from where it stopped, and when tiles change between blocked and open, only the affected part of the search is repaired.
+	// While the entity walks along the path, its position stays on the shortest path from the root, so its own path is the rest of that path. If it strays from it, the search starts over from its position.
+	// Keep one of these per entity, as the search depends on where the entity started
+	class IncrementalPathFinder
+	{
+	public:
+		// Forget the search, e.g. when the map changes completely. The next query starts over
+		void Reset() { rootNode = -1; changedTiles.clear(); }
+		// A tile changed between blocked and open. The search is repaired on the next query
+		void Invalidate(const glm::ivec2& p) { if (rootNode >= 0) changedTiles.push_back(p); }
+		// Calculate a path given a start point, a goal point and the map of blocked tiles, which must be the map that the changes are reported for.
+		// Like PathFinder, the path excludes the start. Unlike PathFinder, the goal must be open. Return an empty path if the goal is unreachable
+		std::vector<glm::ivec2> CalculatePath(const glm::ivec2& start, const glm::ivec2& goal, const BitArray2D& blocked);
+
+	private:
+		// a search key: (min(g, rhs) + heuristic + km, min(g, rhs)), compared lexicographically
+		using Key = std::pair<int, int>;
+
+		// Start a new search from a root tile
+		void BeginSearch(const glm::ivec2& root, const glm::ivec2& goal);
+		// Make sure that a tile's data belongs to the current search, initializing it otherwise
+		void Touch(int node);
+		Key CalculateKey(int node) const;
+		// Recalculate the best distance to the root through the neighbours (rhs), and put the tile in the frontier if it's inconsistent
+		void UpdateNode(int node, const BitArray2D& blocked);
+		// Expand the frontier until the distance to the goal is known
+		void ComputeShortestPath(const BitArray2D& blocked);
+		// Walk back from the goal towards the root along decreasing distances, preferring the steps towards the start.
+		// Return false if the start is not on that path
+		bool ExtractPath(int startNode, const BitArray2D& blocked, std::vector<glm::ivec2>& path) const;
+
+		int ToNode(const glm::ivec2& p) const { return p.x + p.y * mapSize.x; }
+		glm::ivec2 ToPoint(int node) const { return { node % mapSize.x, node / mapSize.x }; }
+		int Heuristic(int nodeA, int nodeB) const;
+
+		// Indexed binary min-heap on the keys, like PathFinder's, but tiles can also be removed or have their key increased
+		void HeapPush(int node, const Key& key);
+		void HeapRemove(int node);
+		void HeapUpdate(int node, const Key& key);
+		void HeapSiftUp(int heapPos);
+		void HeapSiftDown(int heapPos);
+		void HeapSwap(int heapPosA, int heapPosB);
+
+	private:
+		glm::ivec2 mapSize = { 0,0 };
+		// the tile the search is rooted at, or -1 if there's no search
+		int rootNode = -1;
+		// the goal of the last query, and the accumulated heuristic change from the goal moving around (km), which keeps the old keys valid
+		int goalNode = -1;
+		int keyModifier = 0;
+		// the tiles that changed since the last query
+		std::vector<glm::ivec2> changedTiles;
+
+		// per-tile data, indexed by x + y * mapSize.x. As in PathFinder, a tile's data is only valid if its generation matches the current search
+		uint32_t generation = 0;
+		std::vector<uint32_t> visitGeneration;
+		// the distance from the root, and the one-step lookahead distance through the neighbours
+		std::vector<int> gScore;
+		std::vector<int> rhsScore;
+		// the key that each tile has in the heap, and its position in the heap, or -1 if it's not in the heap
+		std::vector<Key> heapKey;
+		std::vector<int> heapIndex;
+
+		// the frontier: tile indices, ordered as a binary heap
+		std::vector<int> heap;
+	};
+}
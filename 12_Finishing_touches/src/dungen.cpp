@@ -1,7 +1,6 @@
 #include "dungen.h"
 
 #include <algorithm>
-#include <random>
 
 #include "grid.h"
 
@@ -15,60 +14,80 @@ namespace rlf
 	static const LevelBgElement bgWall = { "wall", true, true, false, '#', glm::vec4(.7, .7, .7, 1) };
 	static const LevelBgElement bgWater = { "water", false, true, true, '=', glm::vec4(0, 0, 1, 1) };
 
-	// Recursive digging function
-	void Dig(Array2D<LevelBgElement>& layout, int& numLeft, const ivec2& point)
+	// Run a single digging walker from a starting point, until it digs numLeft tiles or runs out of steps. Iterative, so the map size is not limited by the stack
+	void Dig(Array2D<LevelBgElement>& layout, int numLeft, int64_t maxSteps, const ivec2& start, Rng& rng)
 	{
-		auto& elem = layout(point.x, point.y);
-		// Dig if the tile is a blocker
-		if (elem.blocksMovement)
-		{
-			elem = bgFloor;
-			--numLeft;
-		}
-		// If we can still dig
-		if (numLeft > 0)
+		auto point = start;
+		for (int64_t step = 0; ; ++step)
 		{
+			auto& elem = layout(point.x, point.y);
+			// Dig if the tile is a blocker
+			if (elem.blocksMovement)
+			{
+				elem = bgFloor;
+				--numLeft;
+			}
+			// Stop if we dug enough, or if we've been walking for too long
+			if (numLeft <= 0 || step >= maxSteps)
+				break;
 			// Select a new direction that results in a point not in any border tiles or out of the map
-			auto newDir = Nb4()[rand() % 4];
+			auto newDir = Nb4()[rng.Below(4)];
 			while( !layout.InBounds(point + 2*newDir)) // test with 2xnewDir because we don't want to dig the border tiles
-				newDir = Nb4()[rand() % 4];
-			// ... dig again
-			Dig(layout, numLeft, point+newDir);
+				newDir = Nb4()[rng.Below(4)];
+			// ... and walk there
+			point += newDir;
 		}
 	}
 
-	Array2D<LevelBgElement> GenerateDungeon(const glm::ivec2& size)
+	Array2D<LevelBgElement> GenerateDungeon(const glm::ivec2& size, Rng& rng, const DiggerSettings& settings)
 	{
 		// Initialize the map with all walls
 		Array2D<LevelBgElement> layout(size, bgWall);
 		// Start at the center and set it as floor
 		auto center = size / 2;
 		layout(center.x, center.y) = bgFloor;
-		for (const auto& startDir : Nb4())
+		// Each walker digs an equal share of the total
+		auto numWalkers = glm::max(settings.numWalkers, 1);
+		int numToDigPerWalker = int(settings.digFraction * float(size.x) * float(size.y) / float(numWalkers));
+		int64_t maxStepsPerWalker = int64_t(numToDigPerWalker) * settings.maxStepsPerTile;
+		for (int i = 0; i < numWalkers; ++i)
 		{
-			// Run the digger, starting at all 4 adjacent tiles from the center tile
-			int numLeft = (size.x * size.y) / 16;
-			Dig(layout, numLeft, center +startDir);
+			// Run the digger, starting at the 4 adjacent tiles from the center tile in turn
+			auto startDir = Nb4()[i % Nb4().size()];
+			Dig(layout, numToDigPerWalker, maxStepsPerWalker, center + startDir, rng);
 		}
 		return layout;
 	}
 
-	std::vector<std::pair<DbIndex, EntityDynamicConfig>> PopulateDungeon(const Array2D<LevelBgElement>& layout, int numMonsters, int numFeatures, int numTreasures, bool addStairsDown, bool addStairsUp)
+	SpawnTables GatherSpawnTables()
 	{
 		// Get all available monsters/treasures/features and put them into different bins
-		const auto& db = Db::Instance().All();
-		vector<DbIndex> monsters;
-		vector<DbIndex> features;
-		vector<DbIndex> treasures;
-		for_each(db.begin(), db.end(), [&](const auto& nameAndConfig) {
-			if (nameAndConfig.second.type == EntityType::Creature && nameAndConfig.second.allowRandomSpawn)
-				monsters.emplace_back(nameAndConfig.first);
-			else if (nameAndConfig.second.type == EntityType::Object && nameAndConfig.second.allowRandomSpawn)
-				features.emplace_back(nameAndConfig.first);
-			else if (nameAndConfig.second.type == EntityType::Item && nameAndConfig.second.allowRandomSpawn)
-				treasures.emplace_back(nameAndConfig.first);
-		});
-		
+		const auto& db = Db::Instance();
+		SpawnTables spawnTables;
+		for (int i = 0; i < db.Size(); ++i)
+		{
+			auto cfg = db.Get(i);
+			if (cfg == nullptr || !cfg->allowRandomSpawn)
+				continue;
+			if (cfg->type == EntityType::Creature)
+				spawnTables.monsters.push_back(DbIndex::FromIndex(i));
+			else if (cfg->type == EntityType::Object)
+				spawnTables.features.emplace_back(DbIndex::FromIndex(i), cfg->objectCfg.blocksMovement);
+			else if (cfg->type == EntityType::Item)
+				spawnTables.treasures.push_back(DbIndex::FromIndex(i));
+		}
+		spawnTables.stairsDown = DbIndex::StairsDown();
+		spawnTables.stairsUp = DbIndex::StairsUp();
+		spawnTables.itemPile = DbIndex::ItemPile();
+		return spawnTables;
+	}
+
+	std::vector<std::pair<DbIndex, EntityDynamicConfig>> PopulateDungeon(const Array2D<LevelBgElement>& layout, int numMonsters, int numFeatures, int numTreasures, bool addStairsDown, bool addStairsUp, const SpawnTables& spawnTables, Rng& rng)
+	{
+		const auto& monsters = spawnTables.monsters;
+		const auto& features = spawnTables.features;
+		const auto& treasures = spawnTables.treasures;
+
 		// Get all available positions, randomized
 		std::vector<ivec2> availablePositions;
 		availablePositions.reserve(layout.Size().x * layout.Size().y);
@@ -76,13 +95,7 @@ namespace rlf
 			for (int x = 0; x < layout.Size().x; ++x)
 				if (!layout(x, y).blocksMovement)
 					availablePositions.emplace_back(x, y);
-#ifndef _DEBUG // true random in release mode
-		std::random_device rd;
-		std::mt19937 g(rd());
-#else	// same-seed in debug mode
-		std::mt19937 g(2);
-#endif
-		std::shuffle(availablePositions.begin(), availablePositions.end(),g);
+		rng.Shuffle(availablePositions);
 
 		// declare a local function that pops an available position off the back of the available position list
 		auto fnPopPosition = [&availablePositions]()
@@ -95,31 +108,32 @@ namespace rlf
 		std::vector<std::pair<DbIndex, EntityDynamicConfig>> output;
 		// first add stairs (most important)
 		if (addStairsDown)
-			output.emplace_back(DbIndex::StairsDown(), EntityDynamicConfig{fnPopPosition()});
+			output.emplace_back(spawnTables.stairsDown, EntityDynamicConfig{fnPopPosition()});
 		if (addStairsUp)
-			output.emplace_back(DbIndex::StairsUp(), EntityDynamicConfig{ fnPopPosition() });
+			output.emplace_back(spawnTables.stairsUp, EntityDynamicConfig{ fnPopPosition() });
 		// add monsters
 		for(int i=0;i<numMonsters;++i)
-			output.emplace_back(monsters[rand()%monsters.size()], EntityDynamicConfig{fnPopPosition()});
+			output.emplace_back(monsters[rng.Below(int(monsters.size()))], EntityDynamicConfig{fnPopPosition()});
 		// add treasures
 		for (int i = 0; i < numTreasures; ++i)
 		{
 			auto dcfg = EntityDynamicConfig{ fnPopPosition() };
-			dcfg.inventory.push_back(treasures[rand() % treasures.size()]);
-			output.emplace_back(DbIndex::ItemPile(), dcfg);
+			dcfg.inventory.push_back(treasures[rng.Below(int(treasures.size()))]);
+			output.emplace_back(spawnTables.itemPile, dcfg);
 		}
 		// add features, but careful as they have the potential to be blocking narrow passageways!
 		for (int i = 0; i < numFeatures; ++i)
 		{
 			// get a feature
-			const auto& feature = features[rand() % features.size()];
+			const auto& featureEntry = features[rng.Below(int(features.size()))];
+			const auto& feature = featureEntry.first;
 			// only attempt to place if we have enough positions available
 			while (!availablePositions.empty())
 			{
 				// pop a position
 				auto position = fnPopPosition();
 				// if the feature blocks movement, need further checks to ensure passability
-				if (feature.Cfg()->objectCfg.blocksMovement)
+				if (featureEntry.second)
 				{
 					// calculate the number of walkable neighbours (4-connected). We need at least 3!
 					int numFloorNbs = 0;
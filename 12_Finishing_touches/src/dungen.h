@@ -2,11 +2,39 @@
 
 #include "Array2D.h"
 #include "level.h"
+#include "rng.h"
 
 namespace rlf
 {
+	// Settings for the dungeon digger: a number of "drunkard walkers" start around the center of the map, and dig random paths until they have dug enough floor tiles
+	struct DiggerSettings
+	{
+		// number of walkers. They start next to the center tile, in each of the 4 directions in turn
+		int numWalkers = 4;
+		// fraction of the map area that is dug in total, split evenly between the walkers
+		float digFraction = 0.25f;
+		// a walker stops after this many steps per tile it needs to dig, even if it hasn't dug enough. This bounds generation time to be linear in the map area
+		int maxStepsPerTile = 64;
+	};
+
+	// The entities that a dungeon can be populated with. They are gathered from the database beforehand, so that populating a dungeon doesn't use the database,
+	// which isn't thread-safe. This way levels can be generated in the background
+	struct SpawnTables
+	{
+		std::vector<DbIndex> monsters;
+		std::vector<DbIndex> treasures;
+		// dungeon features, and if each one blocks movement
+		std::vector<std::pair<DbIndex, bool>> features;
+		// the special entities that every level needs
+		DbIndex stairsDown;
+		DbIndex stairsUp;
+		DbIndex itemPile;
+	};
+
+	// Gather the spawn tables from the database. Call from the thread that owns the database
+	SpawnTables GatherSpawnTables();
 	// Generate the dungeon layout (floor/wall/liquid/etc)
-	Array2D<LevelBgElement> GenerateDungeon(const glm::ivec2& size);
-	// Populate the dungeon with monsters, treasures, dungeon features, stairs, etc. Return a vector of (entity configuration, dynamic entity configuration) data
-	std::vector<std::pair<DbIndex, EntityDynamicConfig>> PopulateDungeon(const Array2D<LevelBgElement>& layout, int numMonsters, int numFeatures, int numTreasures, bool addStairsDown, bool addStairsUp);
+	Array2D<LevelBgElement> GenerateDungeon(const glm::ivec2& size, Rng& rng, const DiggerSettings& settings = {});
+	// Populate the dungeon with monsters, treasures, dungeon features, stairs, etc, picked from the spawn tables. Return a vector of (entity configuration, dynamic entity configuration) data
+	std::vector<std::pair<DbIndex, EntityDynamicConfig>> PopulateDungeon(const Array2D<LevelBgElement>& layout, int numMonsters, int numFeatures, int numTreasures, bool addStairsDown, bool addStairsUp, const SpawnTables& spawnTables, Rng& rng);
 }
\ No newline at end of file
@@ -1,9 +1,9 @@
 #include "entity.h"
 #include "game.h"
-#include "graphics.h"
 #include "commands.h"
 #include "grid.h"
 #include "signals.h"
+#include "entitypool.h"
 
 using namespace glm;
 
@@ -31,38 +31,36 @@ namespace rlf
 	{
 		this->dbIndex = dbIndex;
 		this->id = id;
-		name = dcfg.nameOverride.empty() ? dbIndex.name : dcfg.nameOverride;
+		name = dcfg.nameOverride.empty() ? dbIndex.Name() : dcfg.nameOverride;
 		const auto& cfg = dbIndex.Cfg();
 		type = cfg->type;
 
-		// clear everything else
+		// clear everything else. The pool has already removed any components of the previous entity in this slot
 		location = {};
-		inventory.reset();
-		creatureData.reset();
-		objectData.reset();
-		itemData.reset();
+		auto& pool = Game::Instance().GetEntityPool();
+		const int slot = id.id;
 
 		// any other work, now that the basics are done
 
 		// Initialization depending on the entity type
 		if (type == EntityType::Creature)
 		{
-			inventory = std::make_unique<Inventory>(); // Creatures always have inventory
-			creatureData = std::make_unique<CreatureData>();
-			creatureData->hp = cfg->creatureCfg.hp;
+			pool.Inventories().Add(slot); // Creatures always have inventory
+			auto& creatureData = pool.Creatures().Add(slot);
+			creatureData.hp = cfg->creatureCfg.hp;
 		}
 		else if (type == EntityType::Object)
 		{
-			objectData = std::make_unique<ObjectData>();
-			objectData->blocksMovement = cfg->objectCfg.blocksMovement;
-			objectData->blocksVision = cfg->objectCfg.blocksVision;
-			objectData->state = cfg->objectCfg.defaultState;
+			auto& objectData = pool.Objects().Add(slot);
+			objectData.blocksMovement = cfg->objectCfg.blocksMovement;
+			objectData.blocksVision = cfg->objectCfg.blocksVision;
+			objectData.state = cfg->objectCfg.defaultState;
 		}
 		else if (type == EntityType::Item)
 		{
-			itemData = std::make_unique<ItemData>();
-			itemData->stackSize = cfg->itemCfg.IsStackable() ? cfg->itemCfg.defaultStackSize : 1;
-			itemData->owner = dcfg.itemOwner;
+			auto& itemData = pool.Items().Add(slot);
+			itemData.stackSize = cfg->itemCfg.IsStackable() ? cfg->itemCfg.defaultStackSize : 1;
+			itemData.owner = dcfg.itemOwner;
 		}
 		
 		// items don't have a position
@@ -72,8 +70,10 @@ namespace rlf
 		// Add inventory items where applicable
 		if (DbCfg() == DbIndex::ItemPile() || !dcfg.inventory.empty())
 		{
-			if(!inventory)
-				inventory = std::make_unique<Inventory>();
+			// component pointers are stable, so it's ok to keep this while we create more entities
+			auto inventory = GetInventory();
+			if(inventory == nullptr)
+				inventory = &pool.Inventories().Add(slot);
 			EntityDynamicConfig dcfgItem;
 			dcfgItem.itemOwner = id;
 			for (const auto& itemCfg : dcfg.inventory)
@@ -82,20 +82,42 @@ namespace rlf
 
 		if (dbIndex == DbIndex::Door())
 		{
+			auto objectData = GetObjectData();
 			objectData->blocksMovement = true;
 			objectData->blocksVision = true;
 			objectData->state = 0;
 		}	
 	}
 
+	Inventory* Entity::GetInventory() const 
+	{ 
+		return Game::Instance().GetEntityPool().Inventories().Get(id.id); 
+	}
+
+	CreatureData* Entity::GetCreatureData() const 
+	{ 
+		return Game::Instance().GetEntityPool().Creatures().Get(id.id); 
+	}
+
+	ObjectData* Entity::GetObjectData() const 
+	{ 
+		return Game::Instance().GetEntityPool().Objects().Get(id.id); 
+	}
+
+	ItemData* Entity::GetItemData() const 
+	{ 
+		return Game::Instance().GetEntityPool().Items().Get(id.id); 
+	}
+
 	const TileData& Entity::CurrentTileData() const
 	{
 		// If we're an item pile with a single item, show the tile data of that single item
+		auto inventory = GetInventory();
 		if (DbCfg() == DbIndex::ItemPile() && inventory->items.size() == 1)
 			return inventory->items[0].Entity()->CurrentTileData();
 		else
 		{
-			int state = Type() == EntityType::Object ? objectData->state : 0;
+			int state = Type() == EntityType::Object ? GetObjectData()->state : 0;
 			return DbCfg().Cfg()->tileData[state];
 		}
 	}
@@ -109,7 +131,7 @@ namespace rlf
 			return true;
 			// Objects MAY block movement
 		case EntityType::Object:
-			return objectData->blocksMovement;
+			return GetObjectData()->blocksMovement;
 		default:
 			assert(false); // don't be here
 			break;
@@ -126,7 +148,7 @@ namespace rlf
 			return false;
 			// objects may block vision
 		case EntityType::Object:
-			return objectData->blocksVision;
+			return GetObjectData()->blocksVision;
 		default:
 			assert(false); // don't be here
 			break;
@@ -17,6 +17,7 @@ namespace rlf
 {
 	class Game;
 	class Entity;
+	class EntityPool;
 	
 	// The entity type. For this project, either a creature, object or item.
 	enum class EntityType : uint32_t
@@ -199,10 +200,11 @@ namespace rlf
 		const std::string& Name()  { return name; }
 		void SetLocation(const Location& newLocation)  { location = newLocation; }
 		const Location& GetLocation() const  { return location; }
-		Inventory* GetInventory() const  { return inventory.get(); }
-		CreatureData* GetCreatureData() const  { return creatureData.get(); }
-		ObjectData* GetObjectData() const  { return objectData.get(); }
-		ItemData* GetItemData() const  { return itemData.get(); }
+		// Components are stored in the game's EntityPool, null if N/A
+		Inventory* GetInventory() const;
+		CreatureData* GetCreatureData() const;
+		ObjectData* GetObjectData() const;
+		ItemData* GetItemData() const;
 
 		// Does this entity block movement?
 		bool BlocksMovement() const;
@@ -217,8 +219,9 @@ namespace rlf
 		void Initialize(EntityId id, DbIndex dbIndex, const EntityDynamicConfig& dcfg);
 
 		// friends for easy serialization
-		friend void from_json(const nlohmann::json& j, Entity& entity);
-		friend void to_json(nlohmann::json& j, const Entity& entity);
+		friend void from_json(const nlohmann::json& j, EntityPool& pool);
+		friend void to_json(nlohmann::json& j, const EntityPool& pool);
+		friend class BinarySave;
 		
 	private:
 
@@ -234,11 +237,6 @@ namespace rlf
 
 		// Location (level and position), useful for creatures and objects
 		Location location;
-		// Inventory is useful for creatures and sometimes objects
-		std::unique_ptr<Inventory> inventory;
-		// data specific to different entity types (a creature has creatureData, etc), null if N/A
-		std::unique_ptr<CreatureData> creatureData;
-		std::unique_ptr<ObjectData> objectData;
-		std::unique_ptr<ItemData> itemData;
+		// The inventory (useful for creatures and sometimes objects) and the data specific to different entity types live in the EntityPool, indexed by our slot
 	};
 }
@@ -0,0 +1,82 @@
+#include "entitypool.h"
+
+namespace rlf
+{
+	EntityId EntityPool::Allocate()
+	{
+		EntityId id;
+		// if we have a free slot, pop it from the list. The version has been already bumped when the slot was freed
+		if (firstFreeSlot >= 0)
+		{
+			id.id = firstFreeSlot;
+			firstFreeSlot = nextFreeSlot[id.id];
+			nextFreeSlot[id.id] = -1;
+		}
+		// otherwise create a new slot at the end
+		else
+		{
+			id.id = int(versions.size());
+			versions.push_back(1);
+			nextFreeSlot.push_back(-1);
+			entities.Add(id.id);
+		}
+		id.version = versions[id.id];
+
+		// remove all components of the previous entity in that slot
+		inventories.Remove(id.id);
+		creatures.Remove(id.id);
+		objects.Remove(id.id);
+		items.Remove(id.id);
+		return id;
+	}
+
+	void EntityPool::Free(const EntityId& id)
+	{
+		// make sure we don't free the slot twice, or free a newer entity using an old id
+		if (Get(id) != nullptr)
+			FreeSlot(id.id);
+	}
+
+	void EntityPool::FreeSlot(int slot)
+	{
+		++versions[slot];
+		nextFreeSlot[slot] = firstFreeSlot;
+		firstFreeSlot = slot;
+	}
+
+	std::vector<int> EntityPool::FreeSlots() const
+	{
+		std::vector<int> freeSlots;
+		for (int slot = firstFreeSlot; slot >= 0; slot = nextFreeSlot[slot])
+			freeSlots.push_back(slot);
+		return freeSlots;
+	}
+
+	Entity& EntityPool::RestoreSlot(int slot, int version)
+	{
+		if (int(versions.size()) <= slot)
+		{
+			versions.resize(slot + 1, 1);
+			nextFreeSlot.resize(slot + 1, -1);
+		}
+		versions[slot] = version;
+		inventories.Remove(slot);
+		creatures.Remove(slot);
+		objects.Remove(slot);
+		items.Remove(slot);
+		auto entity = entities.Get(slot);
+		return entity != nullptr ? *entity : entities.Add(slot);
+	}
+
+	void EntityPool::Clear()
+	{
+		entities.Clear();
+		versions.clear();
+		firstFreeSlot = -1;
+		nextFreeSlot.clear();
+		inventories.Clear();
+		creatures.Clear();
+		objects.Clear();
+		items.Clear();
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "entity.h"
+#include "entityid.h"
+
+namespace rlf
+{
+	// Storage for one component type, indexed by entity slot (EntityId::id). Components are stored contiguously in fixed-size pages:
+	// pages are allocated once and never move, so pointers to components stay valid when the pool grows
+	template<class T>
+	class ComponentPool
+	{
+	public:
+		// Get the component of a slot, or nullptr if the slot doesn't have one
+		T* Get(int slot) const { return (slot >= 0 && slot < int(present.size()) && present[slot]) ? &pages[slot >> PAGE_SHIFT][slot & PAGE_MASK] : nullptr; }
+
+		// Add a component to a slot (or reset the existing one) and return it
+		T& Add(int slot)
+		{
+			while (int(pages.size()) <= (slot >> PAGE_SHIFT))
+				pages.emplace_back(new T[PAGE_SIZE]);
+			if (int(present.size()) <= slot)
+				present.resize(slot + 1, 0);
+			present[slot] = 1;
+			auto& component = pages[slot >> PAGE_SHIFT][slot & PAGE_MASK];
+			component = T();
+			return component;
+		}
+
+		// Remove the component of a slot
+		void Remove(int slot)
+		{
+			if (slot >= 0 && slot < int(present.size()))
+				present[slot] = 0;
+		}
+
+		// Remove everything, and release the memory
+		void Clear()
+		{
+			pages.clear();
+			present.clear();
+		}
+
+	private:
+		static constexpr int PAGE_SHIFT = 8;
+		static constexpr int PAGE_SIZE = 1 << PAGE_SHIFT;
+		static constexpr int PAGE_MASK = PAGE_SIZE - 1;
+
+		// the component pages, each storing PAGE_SIZE components
+		std::vector<std::unique_ptr<T[]>> pages;
+		// does the slot have a component?
+		std::vector<uint8_t> present;
+	};
+
+	// Storage for all entities and their components. Each component type lives in its own pool, and everything is indexed by the entity slot
+	// Slots are handed out like a slot map: each slot has a version that is bumped when the slot is freed, so ids to a freed entity don't resolve anymore,
+	// and free slots are linked in an intrusive list so that they can be reused in O(1)
+	class EntityPool
+	{
+	public:
+		// Get an entity using an id. Return nullptr if the id is invalid, or refers to an entity that was freed
+		Entity* Get(const EntityId& id) const { return (unsigned(id.id) < unsigned(versions.size()) && versions[id.id] == id.version) ? entities.Get(id.id) : nullptr; }
+		// Get the entity stored at a slot, or nullptr if the slot was never used. This does not check versions, and can return freed entities
+		Entity* GetSlot(int slot) const { return entities.Get(slot); }
+		// Number of slots that have been used
+		int Size() const { return int(versions.size()); }
+
+		// Allocate a slot for a new entity, reusing a free one if possible, and return the id for it. The entity at that slot has no components
+		EntityId Allocate();
+		// Free the slot of an entity, so that it can be reused. Any ids to this entity become invalid
+		void Free(const EntityId& id);
+		// Remove everything
+		void Clear();
+
+		// Serialization support: restore the entity at a slot with a given version, and mark a restored slot as free
+		Entity& RestoreSlot(int slot, int version);
+		void FreeSlot(int slot);
+		// Serialization support: get all the free slots
+		std::vector<int> FreeSlots() const;
+
+		// Component access
+		ComponentPool<Inventory>& Inventories() { return inventories; }
+		ComponentPool<CreatureData>& Creatures() { return creatures; }
+		ComponentPool<ObjectData>& Objects() { return objects; }
+		ComponentPool<ItemData>& Items() { return items; }
+		const ComponentPool<Inventory>& Inventories() const { return inventories; }
+		const ComponentPool<CreatureData>& Creatures() const { return creatures; }
+		const ComponentPool<ObjectData>& Objects() const { return objects; }
+		const ComponentPool<ItemData>& Items() const { return items; }
+
+	private:
+		// the entities themselves: a slot is "present" once it has been used at least once. Freed slots keep their entity, so that we know the old version
+		ComponentPool<Entity> entities;
+		// the current version of each slot. For a free slot, this is the version that the next entity in that slot will get
+		std::vector<int> versions;
+		// the free list: first free slot and, for each free slot, the next one (-1 for none)
+		int firstFreeSlot = -1;
+		std::vector<int> nextFreeSlot;
+
+		// the component pools
+		ComponentPool<Inventory> inventories;
+		ComponentPool<CreatureData> creatures;
+		ComponentPool<ObjectData> objects;
+		ComponentPool<ItemData> items;
+	};
+}
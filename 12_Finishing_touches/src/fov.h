@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdlib>
 #include <functional>
+#include <vector>
 #include <glm/glm.hpp>
 
 namespace rlf
@@ -9,4 +11,207 @@ namespace rlf
 	//	cb_is_opaque: this is called to determine whether a 2D point refers to an opaque point on the map (e.g. a wall)
 	//	cb_on_visible: this is called when a 2D point is calculated as being visible
 	void CalculateFieldOfView(const glm::ivec2& start, int radius, const glm::ivec2& map_size, const std::function<bool(const glm::ivec2&)>& cb_is_opaque, const std::function<void(const glm::ivec2&)>& cb_on_visible);
-}
\ No newline at end of file
+
+	// A slope in the shadowcasting algorithm, stored as an exact fraction num/den (den > 0)
+	struct FovSlope
+	{
+		int num;
+		int den;
+		bool operator < (const FovSlope& other) const { return num * other.den < other.num * den; }
+	};
+
+	// Same as CalculateFieldOfView, but the callbacks are template parameters, so that they can be inlined in the hot loop. Use this for anything performance-sensitive
+	// This is the roguebasin recursive shadowcasting implementation, made iterative with an explicit stack and using exact integer slopes
+	// http://www.roguebasin.com/index.php/C%2B%2B_shadowcasting_implementation
+	template<class FnIsOpaque, class FnOnVisible>
+	void ShadowcastFieldOfView(const glm::ivec2& start, int radius, const glm::ivec2& mapSize, FnIsOpaque&& fnIsOpaque, FnOnVisible&& fnOnVisible)
+	{
+		// transforms from octant-space to map-space
+		static constexpr int multipliers[4][8] = {
+			{1, 0, 0, -1, -1, 0, 0, 1},
+			{0, 1, -1, 0, 0, -1, 1, 0},
+			{0, 1, 1, 0, 0, -1, -1, 0},
+			{1, 0, 0, 1, -1, 0, 0, -1}
+		};
+		// a part of a row to scan, between two slopes. This is what the recursive version passes as arguments
+		struct ScanRange
+		{
+			int row;
+			FovSlope startSlope;
+			FovSlope endSlope;
+		};
+		std::vector<ScanRange> ranges;
+		ranges.reserve(64);
+
+		const int radius2 = radius * radius;
+		fnOnVisible(start);
+		for (int octant = 0; octant < 8; ++octant)
+		{
+			const int xx = multipliers[0][octant];
+			const int xy = multipliers[1][octant];
+			const int yx = multipliers[2][octant];
+			const int yy = multipliers[3][octant];
+			ranges.push_back({ 1, {1, 1}, {0, 1} });
+			while (!ranges.empty())
+			{
+				auto range = ranges.back();
+				ranges.pop_back();
+				auto startSlope = range.startSlope;
+				const auto endSlope = range.endSlope;
+				if (startSlope < endSlope)
+					continue;
+				auto nextStartSlope = startSlope;
+				for (int i = range.row; i <= radius; ++i)
+				{
+					bool blocked = false;
+					// dx goes from -i to 0, so u = -dx goes from i to 0. With dy = -i, the slopes of the left and right edge of the cell are:
+					//	left = (dx - 0.5) / (dy + 0.5) = (1 + 2u) / (2i - 1)
+					//	right = (dx + 0.5) / (dy - 0.5) = (2u - 1) / (2i + 1)
+					for (int u = i; u >= 0; --u)
+					{
+						const FovSlope leftSlope = { 1 + 2 * u, 2 * i - 1 };
+						const FovSlope rightSlope = { 2 * u - 1, 2 * i + 1 };
+						if (startSlope < rightSlope)
+							continue;
+						else if (leftSlope < endSlope)
+							break;
+
+						const int dx = -u;
+						const int dy = -i;
+						const glm::ivec2 p = { start.x + dx * xx + dy * xy, start.y + dx * yx + dy * yy };
+						if (p.x < 0 || p.y < 0 || p.x >= mapSize.x || p.y >= mapSize.y)
+							continue;
+
+						if (dx * dx + dy * dy < radius2)
+							fnOnVisible(p);
+
+						const bool isOpaque = fnIsOpaque(p);
+						if (blocked)
+						{
+							if (isOpaque)
+							{
+								nextStartSlope = rightSlope;
+								continue;
+							}
+							else
+							{
+								blocked = false;
+								startSlope = nextStartSlope;
+							}
+						}
+						else if (isOpaque)
+						{
+							// scan the rest of the octant past this blocker later
+							blocked = true;
+							nextStartSlope = rightSlope;
+							ranges.push_back({ i + 1, startSlope, leftSlope });
+						}
+					}
+					if (blocked)
+						break;
+				}
+			}
+		}
+	}
+
+	// Symmetric shadowcasting, from https://www.albertford.com/shadowcasting/
+	// Unlike ShadowcastFieldOfView, a tile is only visible if its centre can be seen from the centre of the start tile, so A sees B exactly when B sees A.
+	// The map is scanned in 4 quadrants, row by row, and each opaque tile blocks its row between its two edges. Opaque tiles are also reported only if their centre is visible,
+	// so this is meant for line of sight between creatures rather than for display. Tiles outside the map count as opaque
+	template<class FnIsOpaque, class FnOnVisible>
+	void SymmetricShadowcastFieldOfView(const glm::ivec2& start, int radius, const glm::ivec2& mapSize, FnIsOpaque&& fnIsOpaque, FnOnVisible&& fnOnVisible)
+	{
+		// transforms from quadrant-space (depth, column) to map-space: north, east, south, west
+		static constexpr int depthAxis[4][2] = { {0, -1}, {1, 0}, {0, 1}, {-1, 0} };
+		static constexpr int columnAxis[4][2] = { {1, 0}, {0, 1}, {1, 0}, {0, 1} };
+		// a row to scan, between two slopes (column / depth)
+		struct ScanRow
+		{
+			int depth;
+			FovSlope startSlope;
+			FovSlope endSlope;
+		};
+		// floor(num / den) for den > 0
+		const auto fnFloorDiv = [](int num, int den) { return num >= 0 ? num / den : -((-num + den - 1) / den); };
+		std::vector<ScanRow> rows;
+		rows.reserve(64);
+
+		const int radius2 = radius * radius;
+		fnOnVisible(start);
+		for (int quadrant = 0; quadrant < 4; ++quadrant)
+		{
+			const auto fnToMap = [&](int depth, int column) {
+				return glm::ivec2(start.x + depth * depthAxis[quadrant][0] + column * columnAxis[quadrant][0], start.y + depth * depthAxis[quadrant][1] + column * columnAxis[quadrant][1]);
+			};
+			const auto fnIsTileOpaque = [&](const glm::ivec2& p) {
+				return p.x < 0 || p.y < 0 || p.x >= mapSize.x || p.y >= mapSize.y || fnIsOpaque(p);
+			};
+			rows.push_back({ 1, {-1, 1}, {1, 1} });
+			while (!rows.empty())
+			{
+				auto row = rows.back();
+				rows.pop_back();
+				if (row.depth > radius)
+					continue;
+				const int depth = row.depth;
+				// the columns whose tiles touch the slope range, edges included: from round_ties_down(depth * start) to round_ties_up(depth * end).
+				// This differs from the original, which skips tiles that only touch the range at an edge. Here a line along an opaque tile's edge is only blocked if there's another opaque tile on the other side,
+				// which is the same rule as HasSymmetricLineOfSight
+				const int minColumn = -fnFloorDiv(-(2 * depth * row.startSlope.num - row.startSlope.den), 2 * row.startSlope.den);
+				const int maxColumn = fnFloorDiv(2 * depth * row.endSlope.num + row.endSlope.den, 2 * row.endSlope.den);
+				int prevOpaque = -1; // -1: no previous tile, 0: open, 1: opaque
+				for (int column = minColumn; column <= maxColumn; ++column)
+				{
+					const auto p = fnToMap(depth, column);
+					const bool isOpaque = fnIsTileOpaque(p);
+					// the tile centre is within the slopes
+					const bool isCentreVisible = column * row.startSlope.den >= depth * row.startSlope.num && column * row.endSlope.den <= depth * row.endSlope.num;
+					if (isCentreVisible && column * column + depth * depth < radius2 && !(p.x < 0 || p.y < 0 || p.x >= mapSize.x || p.y >= mapSize.y))
+						fnOnVisible(p);
+					// the slope of the tile's left edge
+					const FovSlope edgeSlope = { 2 * column - 1, 2 * depth };
+					if (prevOpaque == 1 && !isOpaque)
+						row.startSlope = edgeSlope;
+					if (prevOpaque == 0 && isOpaque)
+						rows.push_back({ depth + 1, row.startSlope, edgeSlope });
+					prevOpaque = isOpaque ? 1 : 0;
+				}
+				if (prevOpaque == 0)
+					rows.push_back({ depth + 1, row.startSlope, row.endSlope });
+			}
+		}
+	}
+
+	// The line of sight test of SymmetricShadowcastFieldOfView, for a single pair of tiles: the line between the tile centres is followed along its major axis,
+	// and it's blocked if it passes through an opaque tile, or exactly between two opaque tiles. The end tiles themselves don't block, and there's no radius
+	template<class FnIsOpaque>
+	bool HasSymmetricLineOfSight(const glm::ivec2& start, const glm::ivec2& end, FnIsOpaque&& fnIsOpaque)
+	{
+		const auto delta = end - start;
+		const bool isDepthY = std::abs(delta.y) >= std::abs(delta.x);
+		const int depth = std::abs(isDepthY ? delta.y : delta.x);
+		const int column = isDepthY ? delta.x : delta.y;
+		const int depthSign = (isDepthY ? delta.y : delta.x) < 0 ? -1 : 1;
+		const auto fnToMap = [&](int i, int c) { return isDepthY ? glm::ivec2(start.x + c, start.y + i * depthSign) : glm::ivec2(start.x + i * depthSign, start.y + c); };
+		for (int i = 1; i < depth; ++i)
+		{
+			// the line crosses row i at column (i * column / depth). Split it in whole and fractional part
+			const int num = i * column;
+			const int whole = num >= 0 ? num / depth : -((-num + depth - 1) / depth);
+			const int remainder = num - whole * depth;
+			if (2 * remainder < depth)
+			{
+				if (fnIsOpaque(fnToMap(i, whole)))
+					return false;
+			}
+			else if (2 * remainder > depth)
+			{
+				if (fnIsOpaque(fnToMap(i, whole + 1)))
+					return false;
+			}
+			else if (fnIsOpaque(fnToMap(i, whole)) && fnIsOpaque(fnToMap(i, whole + 1)))
+				return false;
+		}
+		return true;
+	}
+}
@@ -1,66 +1,30 @@
 #include "game.h"
 
-#include <gl/glew.h>
-#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cassert>
 
-#include <input.h>
-#include <utility.h>
+#include <fileio.h>
 
 #include "entity.h"
-#include "graphics.h"
+#include "commands.h"
+#include "db.h"
 #include "dungen.h"
 #include "signals.h"
-#include "state/menu.h"
 
 namespace rlf
 {
-	void Game::Init()
-	{
-		// The game initialization is nothing more than starting with the menu state
-		std::unique_ptr<state::State> menu = std::make_unique<state::Menu>();
-		PushState(menu);
-	}
-
 	Entity* Game::GetEntity(const EntityId& entityId)
 	{
-		// is it in invalid list?
-		if (invalidPoolIndices.find(entityId.id) != invalidPoolIndices.end())
-			return nullptr;
-		// out of bounds?
-		if (entityId.id < 0 || entityId.id >= poolEntities.size())
-			return nullptr;
-		auto& entity = poolEntities[entityId.id];
-		// is it an old version?
-		if (!entity || entity->Id().version != entityId.version)
-			return nullptr;
-		// ok, all good, get the entity
-		return entity.get();
+		// the pool checks if the id is valid and the version matches
+		return poolEntities.Get(entityId);
 	}
 
 	EntityId Game::CreateEntity(const DbIndex& cfg, const EntityDynamicConfig& dcfg, bool fireMessage)
 	{
-		// Get an appropriate entity id. 
-		EntityId entityId;
-		// if we have some invalid ones
-		if (!invalidPoolIndices.empty())
-		{
-			// Get the first invalid one and increment the version
-			auto it = invalidPoolIndices.begin();
-			entityId.version = poolEntities[*it]->Id().version + 1;
-			entityId.id = *it;
-			invalidPoolIndices.erase(it);
-		}
-		// no invalid ones
-		else
-		{
-			// create a new one at the end of the pool
-			entityId.id = poolEntities.size();
-			entityId.version = 1;
-			poolEntities.resize(poolEntities.size() + 1);
-		}
-		// create a new entity and initialize it
-		poolEntities[entityId.id].reset(new Entity());
-		poolEntities[entityId.id]->Initialize(entityId,cfg, dcfg);
+		// Get an entity id, from a free slot or a new one
+		auto entityId = poolEntities.Allocate();
+		// initialize the entity in that slot
+		poolEntities.GetSlot(entityId.id)->Initialize(entityId,cfg, dcfg);
 
 		if (fireMessage)
 			sig::onEntityAdded.fire(*entityId.Entity());
@@ -71,7 +35,7 @@ namespace rlf
 	// Remove an entity from the game
 	void Game::RemoveEntity(const Entity& e)
 	{
-		invalidPoolIndices.insert(e.Id().id);
+		poolEntities.Free(e.Id());
 	}
 
 	void Game::ChangeLevel(int iLevel)
@@ -81,36 +45,113 @@ namespace rlf
 		currentLevelIndex = iLevel;
 		if (levels.size() <= currentLevelIndex)
 		{
-			Array2D<LevelBgElement> layout;
-			std::vector<std::pair<DbIndex, EntityDynamicConfig>> entityConfigs;
-			if (iLevel == 0)
-			{
-				auto levelConfig = LoadLevelFromTxtFile(rlf::MediaSearch("maps/starting_map.txt"));
-				layout = std::move(levelConfig.first);
-				entityConfigs = std::move(levelConfig.second);
-			}
+			// use the level from the background generation if it's the right one, otherwise generate it now
+			LevelData levelData;
+			if (pregeneratedLevel.valid() && pregeneratedLevelIndex == iLevel && pregeneratedLevelSeed == seed)
+				levelData = pregeneratedLevel.get();
 			else
-			{
-				auto numMonsters = 5 + iLevel;
-				auto numTreasures = 5 + iLevel;
-				auto numFeatures = glm::min(1 + iLevel, 10);
-				layout = GenerateDungeon({ 64,32 });
-				entityConfigs = PopulateDungeon(layout, numMonsters, numFeatures, numTreasures, true, true);
-			}
+				levelData = GenerateLevelData(iLevel, LevelRng(iLevel), GatherSpawnTables());
+			// creating the entities changes the game state, so it always happens here
 			levels.push_back({});
-			levels.back().Init(layout, entityConfigs, currentLevelIndex);
+			levels.back().Init(levelData.first, levelData.second, currentLevelIndex);
 		}
 		levels[iLevel].StartListening();
+
+		PregenerateNextLevel();
+	}
+
+	Game::LevelData Game::GenerateLevelData(int iLevel, Rng rng, const SpawnTables& spawnTables)
+	{
+		if (iLevel == 0)
+			return LoadLevelFromTxtFile(rlf::MediaSearch("maps/starting_map.txt"), rng);
+		auto numMonsters = 5 + iLevel;
+		auto numTreasures = 5 + iLevel;
+		auto numFeatures = glm::min(1 + iLevel, 10);
+		LevelData levelData;
+		levelData.first = GenerateDungeon({ 64,32 }, rng);
+		levelData.second = PopulateDungeon(levelData.first, numMonsters, numFeatures, numTreasures, true, true, spawnTables, rng);
+		return levelData;
+	}
+
+	void Game::PregenerateLevel(int iLevel)
+	{
+		// already in progress?
+		if (pregeneratedLevel.valid() && pregeneratedLevelIndex == iLevel && pregeneratedLevelSeed == seed)
+			return;
+		// the first level is loaded from a file that refers to the database, so it's always generated on this thread
+		assert(iLevel > 0);
+		// the database isn't thread-safe, so the worker gets everything it needs from it now
+		auto spawnTables = GatherSpawnTables();
+		// replacing the future waits for any previous generation to finish
+		pregeneratedLevelIndex = iLevel;
+		pregeneratedLevelSeed = seed;
+		pregeneratedLevel = std::async(std::launch::async, [iLevel, rng = LevelRng(iLevel), spawnTables = std::move(spawnTables)]()
+		{
+			return GenerateLevelData(iLevel, rng, spawnTables);
+		});
+	}
+
+	void Game::PregenerateNextLevel()
+	{
+		if (currentLevelIndex >= 0 && int(levels.size()) == currentLevelIndex + 1)
+			PregenerateLevel(currentLevelIndex + 1);
+	}
+
+	void Game::DiscardPregeneratedLevel()
+	{
+		// replacing the future waits for the generation to finish
+		pregeneratedLevel = {};
+		pregeneratedLevelIndex = -1;
 	}
 
 	void Game::SetPlayer(const Entity& entity) 
 	{ 
 		playerId = entity.Id();
 		CurrentLevel().UpdateFogOfWar();
-		Graphics::Instance().CenterCameraAtPoint(entity.GetLocation().position);
+		renderer->CenterCameraAtPoint(entity.GetLocation().position);
 		sig::onGuiUpdated.fire();
 	}
 
+	void Game::SetSeed(uint64_t seed)
+	{
+		this->seed = seed;
+		for (size_t i = 0; i < rngStreams.size(); ++i)
+			rngStreams[i] = Rng(seed, i);
+	}
+
+	void Game::StartNewGame(const std::string& playerName, uint64_t seed)
+	{
+		// Initialize the game state
+		New();
+		SetSeed(seed);
+
+		// set the level to first
+		rlf::ChangeLevel(0);
+
+		// find suitable position for the player (entry staircase)
+		const auto& entities = CurrentLevel().Entities();
+		auto itFound = std::find_if(entities.begin(), entities.end(), [](const EntityId& entityId) {
+			return entityId.Entity()->DbCfg() == DbIndex::StairsUp();
+		});
+		auto startPosition = itFound->Entity()->GetLocation().position;
+
+		// Create the player entity
+		EntityDynamicConfig dcfg;
+		dcfg.position = startPosition;
+		dcfg.nameOverride = playerName;
+		// add one of each item, for debugging purposes!
+		const auto& db = Db::Instance();
+		for (int i = 0; i < db.Size(); ++i)
+		{
+			auto cfg = db.Get(i);
+			if (cfg != nullptr && cfg->allowRandomSpawn && cfg->type == EntityType::Item)
+				dcfg.inventory.push_back(DbIndex::FromIndex(i));
+		}
+		DbIndex cfgdb{ "player" };
+		auto player = CreateEntity(cfgdb, dcfg, true).Entity();
+		SetPlayer(*player);
+	}
+
 	void Game::WriteToMessageLog(const std::string& msg)
 	{
 		// if this message is the same as the last one, increment the number of repeats of the last entry
@@ -129,35 +170,4 @@ namespace rlf
 		// process everybody else in the turn system
 		turnSystem.Process();
 	}
-
-	// Render the current game state
-	void Game::RenderCurrentState()
-	{
-		if (!gameStates.empty())
-		{
-			Graphics::Instance().BeginRender();
-			gameStates.back()->Render();
-			Graphics::Instance().EndRender();
-		}
-	}
-
-	// Update the current game state
-	void Game::UpdateCurrentState()
-	{
-		
-		// Ctrl-L reloads all shaders
-		if (Input::GetKeyDown(GLFW_KEY_L) && Input::GetKeyDown(GLFW_KEY_LEFT_CONTROL))
-			Graphics::Instance().ReloadShaders();
-
-		if (!gameStates.empty())
-			gameStates.back()->Update(gameStates);
-		else
-			exit(0); // Be nicer!
-	}
-
-	void Game::PushState(std::unique_ptr<state::State>& state)
-	{
-		gameStates.push_back(std::move(state));
-		gameStates.back()->StartListening();
-	}
 }
\ No newline at end of file
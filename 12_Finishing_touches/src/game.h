@@ -1,8 +1,14 @@
+#include <array>
+#include <future>
 #include <unordered_set>
 
 #include "level.h"
+#include "dungen.h"
 #include "entity.h"
+#include "entitypool.h"
 #include "turn.h"
+#include "renderer.h"
+#include "rng.h"
 #include "state/state.h"
 
 namespace rlf
@@ -13,12 +19,21 @@ namespace rlf
 	// See Game member variables for information on the below
 	struct SaveData
 	{
-		std::vector<std::unique_ptr<Entity>> poolEntities;
+		EntityPool poolEntities;
 		std::unordered_set<int> invalidPoolIndices;
 		EntityId playerId;
 		std::vector<Level> levels;
 		int currentLevelIndex = -1;
 		std::vector<std::pair<std::string, int>> messageLog;
+		uint64_t seed = 0;
+		std::array<Rng, size_t(RngStream::Num)> rngStreams;
+	};
+
+	// The file formats that a game can be saved in. Loading detects the format
+	enum class SaveFormat
+	{
+		Binary = 0, // compact and fast
+		Json		// human-readable, useful for debugging
 	};
 
 	// The game class, storing the game state, and providing functionality for interacting with the stored data
@@ -31,8 +46,13 @@ namespace rlf
 		// Initialization code -- run once after application starts and window is set up
 		void Init();
 
+		// Set the renderer that the game uses. By default the game doesn't render anything
+		void SetRenderer(IRenderer& renderer) { this->renderer = &renderer; }
+
 		// Get an entity pointer using an id
 		Entity * GetEntity(const EntityId& entityId);
+		// Get the storage of all entities and their components
+		EntityPool& GetEntityPool() { return poolEntities; }
 
 		// Get all levels
 		const std::vector<Level>& Levels() const { return levels; }
@@ -73,11 +93,23 @@ namespace rlf
 		// Start a new game
 		void New();
 
-		// Load a saved game. Return if successful
+		// Start a new game and create the player, with the given name, at the first level. The seed determines all randomness in the game
+		void StartNewGame(const std::string& playerName, uint64_t seed);
+
+		// Set the game seed, and reset all random number streams
+		void SetSeed(uint64_t seed);
+		// Get the game seed
+		uint64_t Seed() const { return seed; }
+		// Get the random number generator of a subsystem
+		Rng& GetRng(RngStream stream) { return rngStreams[size_t(stream)]; }
+		// Get a random number generator for generating a level. It depends only on the seed and the level index, so a level is the same no matter when it's generated
+		Rng LevelRng(int levelIndex) const { return Rng(seed, uint64_t(RngStream::Num) + levelIndex); }
+
+		// Load a saved game. Waits for any save in progress first. Return if successful
 		bool Load();
 
-		// Save the game
-		void Save();
+		// Save the game. The game state is captured immediately, and the file is compressed and written in the background. The message log reports when it's done
+		void Save(SaveFormat format = SaveFormat::Binary);
 
 		// Render the current game state
 		void RenderCurrentState();
@@ -89,11 +121,23 @@ namespace rlf
 		void PushState(std::unique_ptr<state::State>& state);
 
 	private:
+		// The data that a new level is created from: the layout, and the entities to create
+		using LevelData = std::pair<Array2D<LevelBgElement>, std::vector<std::pair<DbIndex, EntityDynamicConfig>>>;
+		// Generate the data for a level. Apart from the first level, which is loaded from a file, this touches neither the game state nor the database, so it can run on any thread
+		static LevelData GenerateLevelData(int levelIndex, Rng rng, const SpawnTables& spawnTables);
+		// Start generating the data for a level in the background, so that it's ready when the player gets there
+		void PregenerateLevel(int levelIndex);
+		// Start generating the level after the current one, if it doesn't exist yet
+		void PregenerateNextLevel();
+		// Wait for any level generation in the background, and discard it. Must be called before anything that can change the database, e.g. loading a save
+		void DiscardPregeneratedLevel();
+		// Report the result of the save that is being written in the background, if it has finished. Optionally wait for it
+		void FinishPendingSave(bool wait);
 
-		// entities. Stored as uptr, so that when the vector is resized and the memory is reallocated, our data is not invalidated
-		std::vector<std::unique_ptr<Entity>> poolEntities;
-		// keep a list of deleted entities in the pool, so that we can reuse the indices
-		std::unordered_set<int> invalidPoolIndices;
+	private:
+
+		// entities and their components. Stored in pages, so that when the pool grows, our data is not invalidated
+		EntityPool poolEntities;
 		// store the player entity id
 		EntityId playerId;
 
@@ -105,11 +149,26 @@ namespace rlf
 		// message log: messages and how many times each is encountered
 		std::vector<std::pair<std::string,int>> messageLog;
 
+		// the game seed, and the random number streams that were derived from it
+		uint64_t seed = 0;
+		std::array<Rng, size_t(RngStream::Num)> rngStreams;
+
 		// NON SERIALIZABLE DATA
 		
 		// Turn logic
 		TurnSystem turnSystem;
 
+		// The renderer, if any
+		IRenderer* renderer = &NullRenderer::Instance();
+
+		// The level that is being generated in the background, its index and the seed it was generated with
+		std::future<LevelData> pregeneratedLevel;
+		int pregeneratedLevelIndex = -1;
+		uint64_t pregeneratedLevelSeed = 0;
+
+		// The save that is being written in the background, returning if it was successful
+		std::future<bool> pendingSave;
+
 		// The game state stack
 		state::StateStack gameStates;
 	};
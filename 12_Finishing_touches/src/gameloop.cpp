@@ -0,0 +1,51 @@
+#include "game.h"
+
+#include <GLFW/glfw3.h>
+
+#include <input.h>
+
+#include "state/menu.h"
+
+// The interactive part of the game: the game state stack, driven by input. Headless builds don't use any of this, and drive the game logic directly
+namespace rlf
+{
+	void Game::Init()
+	{
+		// The game initialization is nothing more than starting with the menu state
+		std::unique_ptr<state::State> menu = std::make_unique<state::Menu>();
+		PushState(menu);
+	}
+
+	// Render the current game state
+	void Game::RenderCurrentState()
+	{
+		if (!gameStates.empty())
+		{
+			renderer->BeginRender();
+			gameStates.back()->Render();
+			renderer->EndRender();
+		}
+	}
+
+	// Update the current game state
+	void Game::UpdateCurrentState()
+	{
+		// report a background save when it's done
+		FinishPendingSave(false);
+
+		// Ctrl-L reloads all shaders
+		if (Input::GetKeyDown(GLFW_KEY_L) && Input::GetKeyDown(GLFW_KEY_LEFT_CONTROL))
+			renderer->ReloadShaders();
+
+		if (!gameStates.empty())
+			gameStates.back()->Update(gameStates);
+		else
+			exit(0); // Be nicer!
+	}
+
+	void Game::PushState(std::unique_ptr<state::State>& state)
+	{
+		gameStates.push_back(std::move(state));
+		gameStates.back()->StartListening();
+	}
+}
\ No newline at end of file
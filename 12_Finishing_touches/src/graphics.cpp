@@ -73,6 +73,21 @@ namespace rlf
 		}
 	}
 
+	// Texture units used by all programs. The sampler uniforms are set to these once, when a program is loaded
+	constexpr int TEXTURE_UNIT_TILEMAP = 0;
+	constexpr int TEXTURE_UNIT_SPRITEMAP = 1;
+	constexpr int TEXTURE_UNIT_FOW = 2;
+	// Binding point of the per-frame uniform buffer (FrameBlock in the shaders)
+	constexpr int UNIFORM_BINDING_FRAME = 1;
+
+	// Add a define right after the #version line of a shader, so that the shader uses the code paths that this chapter supports
+	std::string AddShaderDefine(const std::string& source, const char* define)
+	{
+		auto versionLineEnd = source.find('\n', source.find("#version"));
+		auto insertPos = versionLineEnd == std::string::npos ? source.size() : versionLineEnd + 1;
+		return source.substr(0, insertPos) + fmt::format("#define {0}\n", define) + source.substr(insertPos);
+	}
+
 	void Graphics::Init()
 	{
 		// create a number of 3D vertices that form a triangle, specified in a counter-clockwise manner 
@@ -93,12 +108,20 @@ namespace rlf
 
 		// specify the shader names (with an invalid associated program object), and then load them all
 		shaderDb = {
-			{"tilemap_dense",0},
-			{"tilemap_sparse",0},
-			{"tilemap_sparse_gui",0},
-			{"tilemap_sparse_gui_highlight",0},
+			{"tilemap_dense",{}},
+			{"tilemap_sparse",{}},
+			{"tilemap_sparse_gui",{}},
+			{"tilemap_sparse_gui_highlight",{}},
 		};
 		ReloadShaders();
+		programDense = &shaderDb.at("tilemap_dense");
+		programSparse = &shaderDb.at("tilemap_sparse");
+		programSparseGui = &shaderDb.at("tilemap_sparse_gui");
+		programSparseGuiHighlight = &shaderDb.at("tilemap_sparse_gui_highlight");
+
+		// create the per-frame uniform buffer, and bind it once: nothing else uses that binding point
+		uboFrame = CreateBuffer(sizeof(FrameUniforms), &frameUniforms, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BINDING_FRAME, uboFrame);
 
 		// Useful if we want to allocate 2D textures that have odd dimensions and store 1 byte per pixel.
 		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
@@ -151,14 +174,28 @@ namespace rlf
 		{
 			auto vertexShaderFilename = MediaSearch(fmt::format("shaders/{0}.vert", nameAndProgram.first));
 			auto fragmentShaderFilename = MediaSearch(fmt::format("shaders/{0}.frag", nameAndProgram.first));
-			auto newProgram = BuildShader(ReadTextFile(vertexShaderFilename).c_str(), ReadTextFile(fragmentShaderFilename).c_str());;
+			auto vertexShaderSource = AddShaderDefine(ReadTextFile(vertexShaderFilename), "RLF_FRAME_UBO");
+			auto fragmentShaderSource = AddShaderDefine(ReadTextFile(fragmentShaderFilename), "RLF_FRAME_UBO");
+			auto newProgram = BuildShader(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
 			// if the shader loaded successfully, replace the old one
 			if (newProgram != 0)
 			{
+				auto& program = nameAndProgram.second;
 				// if the old shader is valid, release the resource
-				if (nameAndProgram.second != 0)
-					glDeleteProgram(nameAndProgram.second);
-				nameAndProgram.second = newProgram;
+				if (program.id != 0)
+					glDeleteProgram(program.id);
+				program.id = newProgram;
+				FrameworkApp::RequestRedraw();
+
+				// resolve the per-draw uniforms
+				program.uniformLocations[size_t(ShaderUniform::ScreenGridSize)] = glGetUniformLocation(newProgram, "screen_grid_size");
+				program.uniformLocations[size_t(ShaderUniform::ShowInExploredAreas)] = glGetUniformLocation(newProgram, "show_in_explored_areas");
+				program.uniformLocations[size_t(ShaderUniform::TargetIdx)] = glGetUniformLocation(newProgram, "targetIdx");
+
+				// samplers always use the same texture units, so set them once here
+				glProgramUniform1i(newProgram, glGetUniformLocation(newProgram, "tilemap"), TEXTURE_UNIT_TILEMAP);
+				glProgramUniform1i(newProgram, glGetUniformLocation(newProgram, "spritemap"), TEXTURE_UNIT_SPRITEMAP);
+				glProgramUniform1i(newProgram, glGetUniformLocation(newProgram, "fow"), TEXTURE_UNIT_FOW);
 			}
 		}
 	}
@@ -171,8 +208,9 @@ namespace rlf
 		for (auto& kv : bufferMap)
 			kv.second.Dispose();
 		for (auto& kv : shaderDb)
-			if(kv.second != 0)
-				glDeleteProgram(kv.second);
+			if(kv.second.id != 0)
+				glDeleteProgram(kv.second.id);
+		DeleteBuffer(uboFrame);
 		glDeleteVertexArrays(1, &VAO);
 		glDeleteBuffers(1, &VBO);
 		tilemap.Dispose();
@@ -186,6 +224,31 @@ namespace rlf
 
 		// Bind the quad -- we'll keep reusing this, either stretched to fill the entire view, or using instancing (drawing many quads with a single call)
 		glBindVertexArray(VAO);
+
+		// Bind the textures that all programs share, and update the shared uniforms
+		glBindTextureUnit(TEXTURE_UNIT_TILEMAP, tilemap.Texture());
+		glBindTextureUnit(TEXTURE_UNIT_FOW, texFogOfWar);
+		UpdateFrameUniforms();
+	}
+
+	void Graphics::UpdateFrameUniforms()
+	{
+		FrameUniforms newFrameUniforms;
+		newFrameUniforms.tilemapTileNum = tilemap.TileNum();
+		newFrameUniforms.tilemapTileSize = tilemap.TileSize();
+		newFrameUniforms.cameraOffset = cameraOffset;
+		// most frames don't change anything, so skip the upload
+		if (newFrameUniforms != frameUniforms)
+		{
+			frameUniforms = newFrameUniforms;
+			glNamedBufferSubData(uboFrame, 0, sizeof(FrameUniforms), &frameUniforms);
+		}
+	}
+
+	void Graphics::UseProgram(const ShaderProgram& program, const ivec2& screenGridSize)
+	{
+		glUseProgram(program.id);
+		glUniform2i(program.Location(ShaderUniform::ScreenGridSize), screenGridSize.x, screenGridSize.y);
 	}
 
 	void Graphics::EndRender()
@@ -200,23 +263,6 @@ namespace rlf
 		glViewport(screenOffsetPx.x, screenOffsetPx.y, viewSizePx.x, viewSizePx.y);
 	}
 
-	void SetupTilemapAndGrid(uint32_t program, const Tilemap& tilemap, const ivec2& screenGridSize)
-	{
-		// set uniforms for the dense pass
-		glUniform2i(glGetUniformLocation(program, "screen_grid_size"), screenGridSize.x, screenGridSize.y);
-		glBindTextureUnit(0, tilemap.Texture());
-		glUniform1i(glGetUniformLocation(program, "tilemap"), 0);
-		glUniform2i(glGetUniformLocation(program, "tilemap_tile_num"), tilemap.TileNum().x, tilemap.TileNum().y);
-		glUniform2i(glGetUniformLocation(program, "tilemap_tile_size"), tilemap.TileSize().x, tilemap.TileSize().y);
-	}
-
-	void SetupCameraAndFow(uint32_t program, const glm::ivec2& cameraOffset, uint32_t fow)
-	{
-		glUniform2i(glGetUniformLocation(program, "camera_offset"), cameraOffset.x, cameraOffset.y);
-		glBindTextureUnit(2, fow);
-		glUniform1i(glGetUniformLocation(program, "fow"), 2);
-	}
-
 	ivec2 Graphics::RowStartAndNum(const std::string& guiSegment) const
 	{
 		int iRow = 0;
@@ -264,6 +310,7 @@ namespace rlf
 		// if we're updating player data, center the camera at the player
 		if (Game::Instance().IsPlayer(e))
 			CenterCameraAtPoint(position);
+		FrameworkApp::RequestRedraw();
 	}
 
 	void Graphics::OnEntityMoved(const Entity& e)
@@ -286,9 +333,9 @@ namespace rlf
 			if (it != entityToBufferIndex.end())
 			{
 				auto& buffer = e.Type() == EntityType::Creature ? bufferCreatures : bufferObjects;
-				constexpr uvec4 noData{ 0,0,0,0 };
-				buffer.Update(it->second, &noData);
+				buffer.Remove(it->second);
 				entityToBufferIndex.erase(it);
+				FrameworkApp::RequestRedraw();
 			}
 		}
 	}
@@ -311,16 +358,30 @@ namespace rlf
 		});
 		texBg.Init(bg.Size(), renderData.data());	
 		texFogOfWar = CreateTexture(bg.Size(),GL_RED, GL_R8);
+		// upload the whole fog of war, as further changes will only update parts of it
+		OnFogOfWarChanged({ 0,0 }, bg.Size());
 
 		for (const auto& entityId : level.Entities())
 			UpdateRenderableEntity(*entityId.Entity());
+		FrameworkApp::RequestRedraw();
 	}
 
-	void Graphics::OnFogOfWarChanged()
+	void Graphics::OnFogOfWarChanged(const glm::ivec2& rectStart, const glm::ivec2& rectSize)
 	{
 		const auto& fogOfWar = Game::Instance().CurrentLevel().FogOfWar();
 		auto size = fogOfWar.Size();
-		glTextureSubImage2D(texFogOfWar, 0, 0, 0, size.x, size.y, GL_RED, GL_UNSIGNED_BYTE, fogOfWar.Data().data());
+		// upload just the changed rectangle: the source rows are strided by the full map width
+		const auto* rectData = fogOfWar.Data().data() + rectStart.x + rectStart.y * size.x;
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, size.x);
+		glTextureSubImage2D(texFogOfWar, 0, rectStart.x, rectStart.y, rectSize.x, rectSize.y, GL_RED, GL_UNSIGNED_BYTE, rectData);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		FrameworkApp::RequestRedraw();
+	}
+
+	void Graphics::OnGuiUpdated()
+	{
+		isGuiDirty = true;
+		FrameworkApp::RequestRedraw();
 	}
 
 	void Graphics::OnObjectStateChanged(const Entity& object)
@@ -352,9 +413,7 @@ namespace rlf
 
 		SetupViewport({ 0,rowStartAndNum.x }, { screenSize.x, rowStartAndNum.y });
 
-		auto program = shaderDb["tilemap_sparse_gui"];
-		glUseProgram(program);
-		SetupTilemapAndGrid(program, tilemap, { screenSize.x, rowStartAndNum.y });
+		UseProgram(*programSparseGui, { screenSize.x, rowStartAndNum.y });
 		guiSparseBuffer.Draw();
 	}
 
@@ -365,9 +424,7 @@ namespace rlf
 		
 		SetupViewport({ 0,rowStartAndNum.x }, { screenSize.x, rowStartAndNum.y });
 
-		auto program = shaderDb["tilemap_sparse_gui"];
-		glUseProgram(program);
-		SetupTilemapAndGrid(program, tilemap, { screenSize.x, rowStartAndNum.y });
+		UseProgram(*programSparseGui, { screenSize.x, rowStartAndNum.y });
 		guiSparseBuffer.Draw();
 	}
 
@@ -378,20 +435,14 @@ namespace rlf
 		SetupViewport({ 0,rowStartAndNum.x }, { screenSize.x, rowStartAndNum.y });
 
 		// Render bg layer(s) first
-		auto shaderTilemapDense = shaderDb.at("tilemap_dense");
-		glUseProgram(shaderTilemapDense);
-		SetupTilemapAndGrid(shaderTilemapDense, tilemap, { screenSize.x, rowStartAndNum.y });
-		SetupCameraAndFow(shaderTilemapDense, cameraOffset, texFogOfWar);
-		texBg.Draw(shaderTilemapDense);
+		UseProgram(*programDense, { screenSize.x, rowStartAndNum.y });
+		texBg.Draw();
 
 		// Render all sparse buffers using given order
-		auto shaderTilemapSparse = shaderDb.at("tilemap_sparse");
-		glUseProgram(shaderTilemapSparse);
-		SetupTilemapAndGrid(shaderTilemapSparse, tilemap, { screenSize.x, rowStartAndNum.y });
-		SetupCameraAndFow(shaderTilemapSparse, cameraOffset, texFogOfWar);
-		glUniform1f(glGetUniformLocation(shaderTilemapSparse, "show_in_explored_areas"), 1.0f);
+		UseProgram(*programSparse, { screenSize.x, rowStartAndNum.y });
+		glUniform1f(programSparse->Location(ShaderUniform::ShowInExploredAreas), 1.0f);
 		bufferObjects.Draw();
-		glUniform1f(glGetUniformLocation(shaderTilemapSparse, "show_in_explored_areas"), 0.0f);
+		glUniform1f(programSparse->Location(ShaderUniform::ShowInExploredAreas), 0.0f);
 		bufferCreatures.Draw();
 	}
 
@@ -400,9 +451,7 @@ namespace rlf
 		auto rowStartAndNum = RowStartAndNum("main");
 		SetupViewport({ 0,rowStartAndNum.x }, { screenSize.x, rowStartAndNum.y });
 
-		auto program = shaderDb["tilemap_sparse_gui"];
-		glUseProgram(program);
-		SetupTilemapAndGrid(program, tilemap, { screenSize.x, rowStartAndNum.y });
+		UseProgram(*programSparseGui, { screenSize.x, rowStartAndNum.y });
 		guiSparseBuffer.Draw();
 	}
 
@@ -411,11 +460,9 @@ namespace rlf
 		auto rowStartAndNum = RowStartAndNum("main");
 		SetupViewport({ 0,rowStartAndNum.x }, { screenSize.x, rowStartAndNum.y });
 
-		auto program = shaderDb["tilemap_sparse_gui_highlight"];
-		glUseProgram(program);
-		SetupTilemapAndGrid(program, tilemap, { screenSize.x, rowStartAndNum.y });
-		auto blink = ((int(FrameworkApp::Time() * 1000) / 530) % 2) != 0;
-		glUniform1i(glGetUniformLocation(program, "targetIdx"), blink ? -1 : targetIdx);
+		UseProgram(*programSparseGuiHighlight, { screenSize.x, rowStartAndNum.y });
+		auto blink = (int(FrameworkApp::Time() / TARGET_BLINK_PERIOD) % 2) != 0;
+		glUniform1i(programSparseGuiHighlight->Location(ShaderUniform::TargetIdx), blink ? -1 : targetIdx);
 		guiSparseBuffer.Draw();
 	}
 
@@ -423,9 +470,7 @@ namespace rlf
 	{
 		SetupViewport({ 0,0 }, screenSize);
 
-		auto program = shaderDb["tilemap_sparse_gui"];
-		glUseProgram(program);
-		SetupTilemapAndGrid(program, tilemap, screenSize);
+		UseProgram(*programSparseGui, screenSize);
 		buffer.Draw();
 	}
 
@@ -434,7 +479,6 @@ namespace rlf
 		// redo the level and gui
 		const auto& level = Game::Instance().CurrentLevel();
 		OnLevelChanged(level);
-		OnFogOfWarChanged();
 		isGuiDirty = true;
 	}
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include <functional>
 #include <unordered_map>
@@ -7,6 +8,7 @@
 #include <glm/glm.hpp>
 
 #include "entityid.h"
+#include "renderer.h"
 #include "tilemap.h"
 #include "spritemap.h"
 #include "sparsebuffer.h"
@@ -19,21 +21,42 @@ namespace rlf
 	class Entity; 
 	class Level;
 
+	// Uniforms that are set per draw call. Everything else is either in the per-frame uniform buffer, or set once when the program is loaded
+	enum class ShaderUniform
+	{
+		ScreenGridSize = 0,
+		ShowInExploredAreas,
+		TargetIdx,
+		Num
+	};
+
+	// A shader program, along with the locations of the per-draw uniforms. Locations are resolved when the program is (re)loaded, and are -1 if the program doesn't use the uniform
+	struct ShaderProgram
+	{
+		uint32_t id = 0;
+		std::array<int, size_t(ShaderUniform::Num)> uniformLocations;
+
+		int Location(ShaderUniform uniform) const { return uniformLocations[size_t(uniform)]; }
+	};
+
 	// Graphics-related methods and state
-	class Graphics
+	class Graphics : public IRenderer
 	{
 	public:
 
 		static Graphics& Instance() { static Graphics instance; return instance; }
 
+		// The selected target blinks on and off, every this many seconds
+		static constexpr double TARGET_BLINK_PERIOD = 0.53;
+
 		// Initialize the graphics subsystem
 		void Init();
 		// Clear any graphics resources (opengl buffers/textures/etc)
 		void Dispose();
 		// Begin rendering any game elements (this sets a quad as the main rendering primitive, that we use throughout)
-		void BeginRender();
+		void BeginRender() override;
 		// End rendering 
-		void EndRender();
+		void EndRender() override;
 		// Render the typical GUI, which is some character info and a few lines of the log
 		void RenderGui();
 		// Render the header, here a simple row at the top of the screen
@@ -49,7 +72,7 @@ namespace rlf
 		// Get a sparse buffer using a name
 		SparseBuffer& RequestBuffer(const std::string& name) { return bufferMap[name];  }
 		// the centered point is usually the player. This makes the view follow the player's positin
-		void CenterCameraAtPoint(const glm::ivec2& point);
+		void CenterCameraAtPoint(const glm::ivec2& point) override;
 		// From a point in "world" space (e.g. level coordinates), calculate the cell coordinates for gui display, taking into account camera offset
 		glm::ivec2 WorldToScreen(const glm::ivec2& point) const;
 		// given the name of a segment, get the index of the first row, and how many rows does the segment occupy
@@ -57,7 +80,7 @@ namespace rlf
 		// Get the size of the screen in terms of tiles
 		const glm::ivec2& ScreenSize() const { return screenSize; }
 		// Reloads all shaders, allowing you to change the code and see the results immediately during the game
-		void ReloadShaders();
+		void ReloadShaders() override;
 
 	private:
 		// Signal-slots
@@ -65,9 +88,9 @@ namespace rlf
 		void OnEntityAdded(Entity& e);
 		void OnEntityRemoved(Entity& e);
 		void OnLevelChanged(const Level& level);
-		void OnFogOfWarChanged();
+		void OnFogOfWarChanged(const glm::ivec2& rectStart, const glm::ivec2& rectSize);
 		void OnObjectStateChanged(const Entity& e);
-		void OnGuiUpdated() { isGuiDirty = true; }
+		void OnGuiUpdated();
 		void OnGameLoaded();
 
 	private:
@@ -76,6 +99,12 @@ namespace rlf
 
 		// Helper to setup the viewport to render over a specific subgrid in the display
 		void SetupViewport(const glm::ivec2& tileStart, const glm::ivec2& tileNum);
+
+		// Activate a program and set the grid size for the current viewport
+		void UseProgram(const ShaderProgram& program, const glm::ivec2& screenGridSize);
+
+		// Upload the per-frame uniforms, if they have changed
+		void UpdateFrameUniforms();
 		
 	private:
 
@@ -100,7 +129,27 @@ namespace rlf
 		int numVerticesQuad = 0;
 
 		// shaders
-		std::unordered_map<std::string, uint32_t> shaderDb;
+		std::unordered_map<std::string, ShaderProgram> shaderDb;
+		// the programs that we use, cached from the shader db. The pointers stay valid as we never add shaders after initialization
+		const ShaderProgram* programDense = nullptr;
+		const ShaderProgram* programSparse = nullptr;
+		const ShaderProgram* programSparseGui = nullptr;
+		const ShaderProgram* programSparseGuiHighlight = nullptr;
+
+		// Values shared by all programs, uploaded once per frame into a uniform buffer. The layout follows std140 rules (see FrameBlock in the shaders)
+		struct FrameUniforms
+		{
+			glm::ivec2 tilemapTileNum = { 0,0 };
+			glm::ivec2 tilemapTileSize = { 0,0 };
+			glm::ivec2 cameraOffset = { 0,0 };
+			glm::ivec2 padding = { 0,0 };
+
+			bool operator==(const FrameUniforms& other) const { return tilemapTileNum == other.tilemapTileNum && tilemapTileSize == other.tilemapTileSize && cameraOffset == other.cameraOffset; }
+			bool operator!=(const FrameUniforms& other) const { return !(*this == other); }
+		};
+		// the uniform buffer, and the last values that we uploaded to it
+		uint32_t uboFrame = 0;
+		FrameUniforms frameUniforms;
 
 		// tilemap
 		rlf::Tilemap tilemap;
@@ -113,7 +162,7 @@ namespace rlf
 		SparseBuffer bufferObjects;
 		// gpu buffer for level creatures
 		SparseBuffer bufferCreatures;
-		// map from entity id (object/creature) to gpu buffer index
+		// map from entity id (object/creature) to gpu buffer handle
 		std::unordered_map<EntityId, int> entityToBufferIndex;
 		
 		// cpu gui data
@@ -0,0 +1,138 @@
+// Headless simulation: runs the game logic without a window or OpenGL, with a simple bot playing as the player.
+// Useful for balancing and regression runs. Usage: 12_Finishing_touches_headless [numTurns] [saveLoadInterval] [seed]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+#include <fmt/format.h>
+
+#include "game.h"
+#include "db.h"
+#include "entity.h"
+#include "commands.h"
+#include "grid.h"
+
+using namespace rlf;
+
+// Statistics gathered during a simulation
+struct SimulationStats
+{
+	int turns = 0;
+	int deaths = 0;
+	int saveLoads = 0;
+	int deepestLevel = 0;
+};
+
+// Play a single turn as the player: attack adjacent creatures, pick up items, walk towards items or the stairs down
+void PlayBotTurn(Entity& player)
+{
+	auto& g = Game::Instance();
+	const auto& level = g.CurrentLevel();
+	auto position = player.GetLocation().position;
+
+	// attack any adjacent creature
+	for (const auto& nb : Nb4())
+	{
+		auto creature = level.GetEntity(position + nb, true);
+		if (creature != nullptr && creature->Type() == EntityType::Creature)
+		{
+			MoveAdj(player, nb);
+			return;
+		}
+	}
+
+	// pick up items or take the stairs, if we're standing on them
+	auto entityOnGround = level.GetEntity(position, false);
+	if (entityOnGround != nullptr && (entityOnGround->DbCfg() == DbIndex::ItemPile() || entityOnGround->DbCfg() == DbIndex::StairsDown()))
+	{
+		PickUpEverythingOrHandle(player);
+		return;
+	}
+
+	// find the closest item pile, or the stairs down if there are no items left
+	const Entity* goal = nullptr;
+	int goalDistance = 0;
+	for (const auto& entityId : level.Entities())
+	{
+		auto entity = entityId.Entity();
+		auto isItemPile = entity->DbCfg() == DbIndex::ItemPile();
+		if (!isItemPile && !(entity->DbCfg() == DbIndex::StairsDown()))
+			continue;
+		auto delta = glm::abs(entity->GetLocation().position - position);
+		// item piles are preferred, so make the stairs appear far away
+		auto distance = delta.x + delta.y + (isItemPile ? 0 : 100000);
+		if (goal == nullptr || distance < goalDistance)
+		{
+			goal = entity;
+			goalDistance = distance;
+		}
+	}
+
+	// walk towards the goal, or randomly if we can't get there
+	if (goal != nullptr)
+	{
+		auto nextPosition = level.NextStepTowards(player, goal->GetLocation().position);
+		if (nextPosition != position)
+		{
+			MoveAdj(player, nextPosition - position);
+			return;
+		}
+	}
+	MoveAdj(player, Nb4()[g.GetRng(RngStream::Ai).Below(int(Nb4().size()))]);
+}
+
+int main(int argc, char** argv)
+{
+	const int numTurns = argc > 1 ? std::atoi(argv[1]) : 10000;
+	const int saveLoadInterval = argc > 2 ? std::atoi(argv[2]) : 0;
+	// the same seed plays the exact same game, so runs are comparable
+	const uint64_t seed = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1;
+
+	Db::Instance().LoadFromDisk();
+	auto& g = Game::Instance();
+	g.StartNewGame("bot", seed);
+	// creatures use the cached field of view from the player instead of their own line of sight, so both must agree
+	if (!g.CurrentLevel().IsPlayerVisibilityConsistent())
+	{
+		fmt::print("The cached field of view from the player doesn't match the line of sight test, on the starting map\n");
+		return EXIT_FAILURE;
+	}
+
+	SimulationStats stats;
+	auto timeStart = std::chrono::steady_clock::now();
+	for (stats.turns = 0; stats.turns < numTurns; ++stats.turns)
+	{
+		// if the player died, start over
+		auto player = g.PlayerId().Entity();
+		if (player == nullptr || player->GetCreatureData()->hp <= 0)
+		{
+			++stats.deaths;
+			// each new game gets a different seed, derived from the original
+			g.StartNewGame("bot", seed + stats.deaths);
+			player = g.PlayerId().Entity();
+		}
+
+		PlayBotTurn(*player);
+		g.EndTurn();
+		stats.deepestLevel = std::max(stats.deepestLevel, g.GetCurrentLevelIndex());
+
+		// exercise saving and loading
+		if (saveLoadInterval > 0 && ((stats.turns + 1) % saveLoadInterval) == 0)
+		{
+			g.Save();
+			if (!g.Load())
+			{
+				fmt::print("Failed to load the game after saving, at turn {0}\n", stats.turns);
+				return EXIT_FAILURE;
+			}
+			++stats.saveLoads;
+		}
+	}
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+	fmt::print("Seed: {0}\n", seed);
+	fmt::print("Turns: {0}, deaths: {1}, save/loads: {2}, deepest level: {3}\n", stats.turns, stats.deaths, stats.saveLoads, stats.deepestLevel + 1);
+	fmt::print("Time: {0:.3f}s ({1:.0f} turns per second)\n", seconds, stats.turns / std::max(seconds, 1e-9));
+	return 0;
+}
@@ -0,0 +1,315 @@
+#include "hpa.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "grid.h"
+
+using namespace glm;
+using namespace std;
+
+namespace rlf
+{
+	// openings along a border that are at least this long get an entrance at each end instead of one in the middle, so that paths don't detour through the middle
+	static constexpr int LONG_ENTRANCE_LENGTH = 6;
+
+	void HierarchicalPathFinder::Reset(const ivec2& newMapSize)
+	{
+		mapSize = newMapSize;
+		numClusters = (mapSize + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+		clusters.assign(size_t(numClusters.x * numClusters.y), Cluster());
+		for (int y = 0; y < numClusters.y; ++y)
+			for (int x = 0; x < numClusters.x; ++x)
+			{
+				auto& cluster = clusters[x + y * numClusters.x];
+				cluster.origin = ivec2(x, y) * CLUSTER_SIZE;
+				cluster.size = min(ivec2(CLUSTER_SIZE), mapSize - cluster.origin);
+			}
+		const auto numTiles = size_t(mapSize.x * mapSize.y);
+		nodeIndex.assign(numTiles, -1);
+		visitGeneration.assign(numTiles, 0);
+		gScore.resize(numTiles);
+		cameFrom.resize(numTiles);
+		isClosed.resize(numTiles);
+		generation = 0;
+	}
+
+	void HierarchicalPathFinder::Invalidate(const ivec2& p)
+	{
+		auto fnInMap = [this](const ivec2& q) { return q.x >= 0 && q.x < mapSize.x && q.y >= 0 && q.y < mapSize.y; };
+		if (!fnInMap(p))
+			return;
+		// the tile's cluster, and any neighbouring cluster that it borders, as the entrances between them might change
+		const int clusterIndex = ClusterIndex(p);
+		clusters[clusterIndex].isDirty = true;
+		for (const auto& nb : Nb4())
+			if (fnInMap(p + nb) && ClusterIndex(p + nb) != clusterIndex)
+				clusters[ClusterIndex(p + nb)].isDirty = true;
+	}
+
+	void HierarchicalPathFinder::AddBorderEntrances(Cluster& cluster, const BitArray2D& blocked, const ivec2& first, const ivec2& along, const ivec2& across, int length)
+	{
+		// add an entrance at a position along the border, or just the link if the tile is already an entrance (corner tiles can be on two borders)
+		auto fnAddEntrance = [&](int i) {
+			const auto p = first + along * i;
+			const int tile = TileIndex(p);
+			auto it = std::find(cluster.nodes.begin(), cluster.nodes.end(), tile);
+			if (it == cluster.nodes.end())
+			{
+				nodeIndex[tile] = int(cluster.nodes.size());
+				cluster.nodes.push_back(tile);
+				cluster.links.emplace_back();
+				it = cluster.nodes.end() - 1;
+			}
+			cluster.links[it - cluster.nodes.begin()].push_back(TileIndex(p + across));
+		};
+
+		// find the openings: runs of tiles that are open on both sides of the border. Both clusters walk the border in the same direction, so they place the same entrances
+		int runStart = -1;
+		for (int i = 0; i <= length; ++i)
+		{
+			const auto p = first + along * i;
+			const bool isOpen = i < length && !blocked.Get(p) && !blocked.Get(p + across);
+			if (isOpen && runStart < 0)
+				runStart = i;
+			else if (!isOpen && runStart >= 0)
+			{
+				const int runEnd = i - 1;
+				if (runEnd - runStart + 1 >= LONG_ENTRANCE_LENGTH)
+				{
+					fnAddEntrance(runStart);
+					fnAddEntrance(runEnd);
+				}
+				else
+					fnAddEntrance((runStart + runEnd) / 2);
+				runStart = -1;
+			}
+		}
+	}
+
+	void HierarchicalPathFinder::RebuildCluster(Cluster& cluster, const BitArray2D& blocked)
+	{
+		for (auto tile : cluster.nodes)
+			nodeIndex[tile] = -1;
+		cluster.nodes.clear();
+		cluster.links.clear();
+
+		// entrances towards the left, right, top and bottom neighbours
+		const auto& origin = cluster.origin;
+		const auto& size = cluster.size;
+		if (origin.x > 0)
+			AddBorderEntrances(cluster, blocked, origin, { 0,1 }, { -1,0 }, size.y);
+		if (origin.x + size.x < mapSize.x)
+			AddBorderEntrances(cluster, blocked, { origin.x + size.x - 1, origin.y }, { 0,1 }, { 1,0 }, size.y);
+		if (origin.y > 0)
+			AddBorderEntrances(cluster, blocked, origin, { 1,0 }, { 0,-1 }, size.x);
+		if (origin.y + size.y < mapSize.y)
+			AddBorderEntrances(cluster, blocked, { origin.x, origin.y + size.y - 1 }, { 1,0 }, { 0,1 }, size.x);
+
+		// the paths between the entrances
+		cluster.searches.resize(cluster.nodes.size());
+		for (size_t i = 0; i < cluster.nodes.size(); ++i)
+			SearchCluster(cluster, blocked, TilePoint(cluster.nodes[i]), cluster.searches[i]);
+		cluster.isDirty = false;
+	}
+
+	void HierarchicalPathFinder::SearchCluster(const Cluster& cluster, const BitArray2D& blocked, const ivec2& root, ClusterSearch& search) const
+	{
+		const int numTiles = cluster.size.x * cluster.size.y;
+		search.cameFrom.assign(numTiles, -1);
+		search.distance.assign(numTiles, 0);
+		// the tiles are visited in breadth-first order, so the cameFrom array doubles as the "visited" flag, and a plain vector works as the queue
+		std::vector<int16_t> queue;
+		queue.reserve(numTiles);
+		const int rootIndex = LocalIndex(cluster, root);
+		search.cameFrom[rootIndex] = int16_t(rootIndex);
+		queue.push_back(int16_t(rootIndex));
+		for (size_t head = 0; head < queue.size(); ++head)
+		{
+			const int index = queue[head];
+			const auto p = cluster.origin + ivec2(index % cluster.size.x, index / cluster.size.x);
+			for (const auto& nb : Nb4())
+			{
+				const auto q = p + nb;
+				const auto local = q - cluster.origin;
+				if (local.x < 0 || local.x >= cluster.size.x || local.y < 0 || local.y >= cluster.size.y || blocked.Get(q))
+					continue;
+				const int nbIndex = local.x + local.y * cluster.size.x;
+				if (search.cameFrom[nbIndex] >= 0)
+					continue;
+				search.cameFrom[nbIndex] = int16_t(index);
+				search.distance[nbIndex] = int16_t(search.distance[index] + 1);
+				queue.push_back(int16_t(nbIndex));
+			}
+		}
+	}
+
+	void HierarchicalPathFinder::AppendSearchPath(const Cluster& cluster, const ClusterSearch& search, const ivec2& p, bool reversed, std::vector<ivec2>& path) const
+	{
+		const auto fnToPoint = [&cluster](int index) { return cluster.origin + ivec2(index % cluster.size.x, index / cluster.size.x); };
+		int index = LocalIndex(cluster, p);
+		if (reversed)
+		{
+			while (search.cameFrom[index] != index)
+			{
+				index = search.cameFrom[index];
+				path.push_back(fnToPoint(index));
+			}
+		}
+		else
+		{
+			const auto first = path.size();
+			for (; search.cameFrom[index] != index; index = search.cameFrom[index])
+				path.push_back(fnToPoint(index));
+			std::reverse(path.begin() + first, path.end());
+		}
+	}
+
+	vector<ivec2> HierarchicalPathFinder::CalculatePath(const ivec2& start, const ivec2& goal, const BitArray2D& blocked)
+	{
+		if (blocked.Size() != mapSize)
+			Reset(blocked.Size());
+		if (start == goal || !blocked.InBounds(start) || !blocked.InBounds(goal))
+			return {};
+		for (auto& cluster : clusters)
+			if (cluster.isDirty)
+				RebuildCluster(cluster, blocked);
+		if (!blocked.Get(goal))
+			return FindPath(start, goal, blocked);
+
+		// a blocked goal can only be entered from one of its open neighbours, which might be in another cluster. Find the closest of them, and step into the goal from there
+		vector<ivec2> bestPath;
+		for (const auto& nb : Nb4())
+		{
+			const auto p = goal + nb;
+			if (!blocked.InBounds(p) || blocked.Get(p))
+				continue;
+			if (p == start)
+				return { goal };
+			auto path = FindPath(start, p, blocked);
+			if (!path.empty() && (bestPath.empty() || path.size() < bestPath.size()))
+				bestPath = std::move(path);
+		}
+		if (!bestPath.empty())
+			bestPath.push_back(goal);
+		return bestPath;
+	}
+
+	vector<ivec2> HierarchicalPathFinder::FindPath(const ivec2& start, const ivec2& goal, const BitArray2D& blocked)
+	{
+		// Start a new generation, as in PathFinder
+		if (++generation == 0)
+		{
+			std::fill(visitGeneration.begin(), visitGeneration.end(), 0);
+			generation = 1;
+		}
+
+		// connect the start and the goal to the entrances of their clusters
+		const int startClusterIndex = ClusterIndex(start);
+		const int goalClusterIndex = ClusterIndex(goal);
+		const auto& startCluster = clusters[startClusterIndex];
+		const auto& goalCluster = clusters[goalClusterIndex];
+		SearchCluster(startCluster, blocked, start, startSearch);
+		SearchCluster(goalCluster, blocked, goal, goalSearch);
+
+		const int startTile = TileIndex(start);
+		const int goalTile = TileIndex(goal);
+		const auto fnHeuristic = [&](int tile) {
+			auto v = abs(TilePoint(tile) - goal);
+			return v.x + v.y;
+		};
+
+		// A* on the abstract graph: the entrances, the start and the goal. The frontier stores (f-score, tile), and outdated entries are skipped when popped
+		std::vector<std::pair<int, int>> frontier;
+		const auto fnRelax = [&](int fromTile, int toTile, int cost) {
+			const int gScoreNew = gScore[fromTile] + cost;
+			if (visitGeneration[toTile] == generation && (isClosed[toTile] || gScore[toTile] <= gScoreNew))
+				return;
+			visitGeneration[toTile] = generation;
+			isClosed[toTile] = 0;
+			gScore[toTile] = gScoreNew;
+			cameFrom[toTile] = fromTile;
+			frontier.emplace_back(gScoreNew + fnHeuristic(toTile), toTile);
+			std::push_heap(frontier.begin(), frontier.end(), std::greater<>());
+		};
+		// relax the edges from a tile to the other entrances of its cluster, using a search from that tile
+		const auto fnRelaxSearch = [&](int fromTile, const Cluster& cluster, const ClusterSearch& search) {
+			for (auto nodeTile : cluster.nodes)
+			{
+				const int index = LocalIndex(cluster, TilePoint(nodeTile));
+				if (nodeTile != fromTile && search.cameFrom[index] >= 0)
+					fnRelax(fromTile, nodeTile, search.distance[index]);
+			}
+		};
+
+		visitGeneration[startTile] = generation;
+		isClosed[startTile] = 0;
+		gScore[startTile] = 0;
+		cameFrom[startTile] = -1;
+		frontier.emplace_back(fnHeuristic(startTile), startTile);
+
+		bool isGoalFound = false;
+		while (!frontier.empty())
+		{
+			std::pop_heap(frontier.begin(), frontier.end(), std::greater<>());
+			const int tile = frontier.back().second;
+			frontier.pop_back();
+			if (isClosed[tile])
+				continue;
+			isClosed[tile] = 1;
+			if (tile == goalTile)
+			{
+				isGoalFound = true;
+				break;
+			}
+
+			const auto p = TilePoint(tile);
+			const auto& cluster = clusters[ClusterIndex(p)];
+			const int node = nodeIndex[tile];
+			// paths within the cluster: from the start's own search, or the precomputed ones between entrances
+			if (tile == startTile)
+				fnRelaxSearch(tile, cluster, startSearch);
+			else if (node >= 0)
+				fnRelaxSearch(tile, cluster, cluster.searches[node]);
+			// the path to the goal comes from the goal's search
+			if (&cluster == &goalCluster)
+			{
+				const int index = LocalIndex(cluster, p);
+				if (goalSearch.cameFrom[index] >= 0)
+					fnRelax(tile, goalTile, goalSearch.distance[index]);
+			}
+			// steps into the neighbouring clusters
+			if (node >= 0)
+				for (auto linkTile : cluster.links[node])
+					fnRelax(tile, linkTile, 1);
+		}
+		if (!isGoalFound)
+			return {};
+
+		// stitch together the tile path from the abstract one
+		std::vector<int> waypoints;
+		for (int tile = goalTile; tile >= 0; tile = cameFrom[tile])
+			waypoints.push_back(tile);
+		std::reverse(waypoints.begin(), waypoints.end());
+		std::vector<ivec2> path;
+		for (size_t i = 1; i < waypoints.size(); ++i)
+		{
+			const auto from = TilePoint(waypoints[i - 1]);
+			const auto to = TilePoint(waypoints[i]);
+			const int clusterIndex = ClusterIndex(from);
+			if (clusterIndex != ClusterIndex(to))
+				path.push_back(to);
+			// the goal can also be an entrance, reached with the start's search or a precomputed path, so check that the step came from the goal's search
+			else if (waypoints[i] == goalTile && goalSearch.cameFrom[LocalIndex(goalCluster, from)] >= 0)
+				AppendSearchPath(goalCluster, goalSearch, from, true, path);
+			else if (waypoints[i - 1] == startTile)
+				AppendSearchPath(startCluster, startSearch, to, false, path);
+			else
+			{
+				const auto& cluster = clusters[clusterIndex];
+				AppendSearchPath(cluster, cluster.searches[nodeIndex[waypoints[i - 1]]], to, false, path);
+			}
+		}
+		return path;
+	}
+}
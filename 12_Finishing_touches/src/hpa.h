@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include <bitarray2d.h>
+
+namespace rlf
+{
+	// Hierarchical pathfinding (HPA*): the map is split into square clusters, and the tiles where paths cross from one cluster to the next ("entrances") form a small abstract graph.
+	// The shortest paths between the entrances of each cluster are precomputed, so a long query only searches the abstract graph, and the tile path is stitched together from the stored pieces.
+	// Paths are near-optimal, as they always cross borders at entrances. Clusters are rebuilt lazily, only when a tile that affects them changes
+	class HierarchicalPathFinder
+	{
+	public:
+		// The width and height of a cluster, in tiles
+		static constexpr int CLUSTER_SIZE = 16;
+
+		// Start over with a new map size. All clusters are built on the next query
+		void Reset(const glm::ivec2& mapSize);
+		// A tile changed between blocked and open, so the clusters that depend on it need to be rebuilt
+		void Invalidate(const glm::ivec2& p);
+		// Calculate a path given a start point, a goal point and the map of blocked tiles, which must be the map that the changes are reported for.
+		// Like PathFinder, the path excludes the start, and the goal is allowed to be blocked. The start should be open. Return an empty path if the goal is unreachable
+		std::vector<glm::ivec2> CalculatePath(const glm::ivec2& start, const glm::ivec2& goal, const BitArray2D& blocked);
+
+	private:
+		// A breadth-first search within a cluster, from a root tile. Tiles are indexed locally, as x + y * cluster width
+		struct ClusterSearch
+		{
+			// the previous tile on the shortest path from the root, the root itself for the root, or -1 if unreachable
+			std::vector<int16_t> cameFrom;
+			// the distance from the root, valid if the tile is reachable
+			std::vector<int16_t> distance;
+		};
+
+		struct Cluster
+		{
+			// the tiles covered by the cluster. Clusters at the right and bottom edges of the map can be smaller
+			glm::ivec2 origin = { 0,0 };
+			glm::ivec2 size = { 0,0 };
+			bool isDirty = true;
+			// the entrance tiles (global tile indices), and for each one the tiles in neighbouring clusters that it leads to
+			std::vector<int> nodes;
+			std::vector<std::vector<int>> links;
+			// for each entrance, the search from it, to reconstruct the paths to the other entrances
+			std::vector<ClusterSearch> searches;
+		};
+
+		int ClusterIndex(const glm::ivec2& p) const { return (p.x / CLUSTER_SIZE) + (p.y / CLUSTER_SIZE) * numClusters.x; }
+		int TileIndex(const glm::ivec2& p) const { return p.x + p.y * mapSize.x; }
+		glm::ivec2 TilePoint(int tile) const { return { tile % mapSize.x, tile / mapSize.x }; }
+		int LocalIndex(const Cluster& cluster, const glm::ivec2& p) const { return (p.x - cluster.origin.x) + (p.y - cluster.origin.y) * cluster.size.x; }
+
+		// Find a path to an open goal, once the clusters are up to date
+		std::vector<glm::ivec2> FindPath(const glm::ivec2& start, const glm::ivec2& goal, const BitArray2D& blocked);
+		// Rebuild the entrances and the paths between them for a cluster
+		void RebuildCluster(Cluster& cluster, const BitArray2D& blocked);
+		// Add the entrances along one border of a cluster. The border is walked from "first", in steps of "along", and the neighbouring cluster is in direction "across"
+		void AddBorderEntrances(Cluster& cluster, const BitArray2D& blocked, const glm::ivec2& first, const glm::ivec2& along, const glm::ivec2& across, int length);
+		// Search within a cluster from a root tile. The root doesn't need to be open
+		void SearchCluster(const Cluster& cluster, const BitArray2D& blocked, const glm::ivec2& root, ClusterSearch& search) const;
+		// Append the path from the root of a search to a tile (excluding the root), or from the tile to the root if reversed (excluding the tile)
+		void AppendSearchPath(const Cluster& cluster, const ClusterSearch& search, const glm::ivec2& p, bool reversed, std::vector<glm::ivec2>& path) const;
+
+	private:
+		glm::ivec2 mapSize = { 0,0 };
+		glm::ivec2 numClusters = { 0,0 };
+		std::vector<Cluster> clusters;
+		// for each tile, its index in the nodes of its cluster, or -1 if it's not an entrance
+		std::vector<int> nodeIndex;
+
+		// abstract search scratch data, per tile. As in PathFinder, a tile's data is only valid if its generation matches the current query
+		uint32_t generation = 0;
+		std::vector<uint32_t> visitGeneration;
+		std::vector<int> gScore;
+		std::vector<int> cameFrom;
+		std::vector<uint8_t> isClosed;
+		// the searches from the start and the goal of the current query, within their clusters
+		ClusterSearch startSearch;
+		ClusterSearch goalSearch;
+	};
+}
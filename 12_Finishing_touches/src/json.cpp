@@ -1,8 +1,11 @@
 #include "json.h"
 
+#include <chrono>
+
 #include <nlohmann/json.hpp>
 
-#include "utility.h"
+#include "fileio.h"
+#include "binarysave.h"
 #include "signals.h"
 
 namespace glm
@@ -52,57 +55,172 @@ namespace rlf
 		j = json{ {"sprite", std::string(1,c)}, {"color", td.color} };
 	}
 
+	// write a component, or null if the entity doesn't have one
+	template<class T>
+	static json ComponentToJson(const T* component)
+	{
+		return component != nullptr ? json(*component) : json(nullptr);
+	}
+
+	// read a component into a pool, if it's not null
+	template<class T>
+	static void ComponentFromJson(const json& j, ComponentPool<T>& componentPool, int slot)
+	{
+		if (j.is_null())
+			return;
+		auto& component = componentPool.Add(slot);
+		j.get_to(component);
+	}
+
+	void to_json(nlohmann::json& j, const EntityPool& pool)
+	{
+		j = json::array();
+		for (int slot = 0; slot < pool.Size(); ++slot)
+		{
+			const auto& entity = *pool.GetSlot(slot);
+			j.push_back(json{
+				{"dbIndex", entity.dbIndex},
+				{"id", entity.id},
+				{"name", entity.name},
+				{"inventory", ComponentToJson(pool.Inventories().Get(slot))},
+				{"location", entity.location},
+				{"type", entity.type},
+				{"itemData", ComponentToJson(pool.Items().Get(slot))},
+				{"creatureData", ComponentToJson(pool.Creatures().Get(slot))},
+				{"objectData", ComponentToJson(pool.Objects().Get(slot))}
+			});
+		}
+	}
+
+	void from_json(const nlohmann::json& j, EntityPool& pool)
+	{
+		pool.Clear();
+		for (int slot = 0; slot < int(j.size()); ++slot)
+		{
+			const auto& jEntity = j.at(slot);
+			EntityId id = jEntity.at("id");
+			auto& entity = pool.RestoreSlot(slot, id.version);
+			entity.id = id;
+			jEntity.at("dbIndex").get_to(entity.dbIndex);
+			jEntity.at("name").get_to(entity.name);
+			jEntity.at("location").get_to(entity.location);
+			jEntity.at("type").get_to(entity.type);
+			ComponentFromJson(jEntity.at("inventory"), pool.Inventories(), slot);
+			ComponentFromJson(jEntity.at("itemData"), pool.Items(), slot);
+			ComponentFromJson(jEntity.at("creatureData"), pool.Creatures(), slot);
+			ComponentFromJson(jEntity.at("objectData"), pool.Objects(), slot);
+		}
+	}
+
 	void Db::LoadFromDisk()
 	{
 		auto filename = MediaSearch("json/db.json");
 		auto text = ReadTextFile(filename);
 		auto j = json::parse(text);
-		db = j;
+		for (const auto& nameAndConfig : j.items())
+		{
+			EntityConfig cfg;
+			nameAndConfig.value().get_to(cfg);
+			Add(nameAndConfig.key(), cfg);
+		}
+	}
+
+	// Read and parse the save file, in either format. Return if successful
+	static bool ReadSaveFile(SaveData& save)
+	{
+		auto data = ReadBinaryFile("data.sav");
+		if (data.empty())
+			return false;
+		if (BinarySave::IsBinarySave(data))
+			return BinarySave::Read(data, save);
+		save = json::parse(data);
+		return true;
 	}
 
 	void Game::New()
 	{
+		DiscardPregeneratedLevel();
 		currentLevelIndex = -1;
-		invalidPoolIndices.clear();
 		levels.clear();
 		messageLog.clear();
 		playerId = {};
-		poolEntities.clear();
+		poolEntities.Clear();
 	}
 
 	bool Game::Load()
 	{
-		auto text = ReadTextFile("data.sav");
-		if (text.empty())
+		FinishPendingSave(true);
+		// reading the save interns the names it refers to, which changes the database, so the level generation in the background must not be running
+		DiscardPregeneratedLevel();
+		SaveData save;
+		if (!ReadSaveFile(save))
+		{
+			// keep playing the current game, with the next level getting ready again
+			PregenerateNextLevel();
 			return false;
-		SaveData save = json::parse(text);
+		}
+		// the level that we're replacing should stop listening, otherwise it stays connected to the signals
+		if (currentLevelIndex >= 0 && currentLevelIndex < int(levels.size()))
+			levels[currentLevelIndex].StopListening();
 		currentLevelIndex = save.currentLevelIndex;
-		invalidPoolIndices = save.invalidPoolIndices;
-		levels = save.levels;
+		std::swap(levels, save.levels);
 		messageLog = save.messageLog;
 		playerId = save.playerId;
+		seed = save.seed;
+		rngStreams = save.rngStreams;
 		// swap, so the game state gets the save data, and the save object gets the current game state, which will be destructed at the end of the scope
 		std::swap(poolEntities, save.poolEntities);
-		levels.back().StartListening();
+		// the pool restored the versions from the entities, now free the slots that were free when saving
+		for (auto slot : save.invalidPoolIndices)
+			poolEntities.FreeSlot(slot);
+		levels[currentLevelIndex].StartListening();
+		// so that the first stairs after loading don't have to wait for the next level
+		PregenerateNextLevel();
 		sig::onGameLoaded.fire();
 		WriteToMessageLog("Game loaded.");
 		return true;
 	}
 
-	void Game::Save()
+	void Game::Save(SaveFormat format)
 	{
+		// only one save is written at a time
+		FinishPendingSave(true);
 		SaveData save;
 		save.currentLevelIndex = currentLevelIndex;
-		save.invalidPoolIndices = invalidPoolIndices;
-		save.levels = levels;
+		for (auto slot : poolEntities.FreeSlots())
+			save.invalidPoolIndices.insert(slot);
 		save.messageLog = messageLog;
 		save.playerId = playerId;
-		// temp-swap, so the save object gets all the entities just before we convert to json
+		save.seed = seed;
+		save.rngStreams = rngStreams;
+		// temp-swap, so the save object gets all the entities and levels without copying them
 		std::swap(poolEntities, save.poolEntities);
-		json j = save;
-		WriteTextFile("data.sav",j.dump());
-		// swap again, to get the entities back into the game state object
+		std::swap(levels, save.levels);
+		// the snapshot of the game state: the uncompressed binary data, or the json object. Both are quick to create, and don't refer to the game state anymore
+		std::string data;
+		json j;
+		if (format == SaveFormat::Binary)
+			data = BinarySave::Write(save);
+		else
+			j = save;
+		// swap again, to get the entities and levels back into the game state object
 		std::swap(poolEntities, save.poolEntities);
-		WriteToMessageLog("Game saved.");
+		std::swap(levels, save.levels);
+
+		// compress and write the file in the background
+		pendingSave = std::async(std::launch::async, [format, data = std::move(data), j = std::move(j)]()
+		{
+			auto fileData = format == SaveFormat::Binary ? BinarySave::Compress(data) : j.dump();
+			return ReplaceBinaryFile("data.sav", fileData);
+		});
+	}
+
+	void Game::FinishPendingSave(bool wait)
+	{
+		if (!pendingSave.valid())
+			return;
+		if (!wait && pendingSave.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return;
+		WriteToMessageLog(pendingSave.get() ? "Game saved." : "Failed to save the game.");
 	}
 }
\ No newline at end of file
@@ -83,7 +83,9 @@ namespace rlf
     void from_json(const nlohmann::json& j, FogOfWarStatus& e) { e = magic_enum::enum_cast<FogOfWarStatus>(std::string(j)).value(); }
     void to_json(nlohmann::json& j, const FogOfWarStatus& e) { j = magic_enum::enum_name(e); }
 
-	NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(DbIndex, name);
+	// DbIndex is stored by name, as indices depend on the order of loading
+	void from_json(const nlohmann::json& j, DbIndex& e) { e = DbIndex(j.at("name").get<std::string>()); }
+	void to_json(nlohmann::json& j, const DbIndex& e) { j = nlohmann::json{ {"name", e.Name()} }; }
 	NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(EntityId, version, id);
     NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_OPT(ItemConfig, defaultStackSize, weight, category, combatStatBonuses, effect, attackRange);
     NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_OPT(CreatureConfig, lineOfSightRadius, hp, combatStats);
@@ -97,6 +99,10 @@ namespace rlf
     NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(ItemData, stackSize, owner, equipped);
     NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Location, levelId, position);
     NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Level, bg, entities, fogOfWar);
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Entity, dbIndex, id, name, inventory, location, type, itemData, creatureData, objectData);
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(SaveData, poolEntities, invalidPoolIndices, playerId, levels, currentLevelIndex, messageLog);
+    // The entity pool is stored as an array of entities, each with its components (or null if the entity doesn't have one)
+    void from_json(const nlohmann::json& j, EntityPool& pool);
+    void to_json(nlohmann::json& j, const EntityPool& pool);
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Rng, state, increment);
+    // optional fields, so that saves from before the seed was stored can still be loaded
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_OPT(SaveData, poolEntities, invalidPoolIndices, playerId, levels, currentLevelIndex, messageLog, seed, rngStreams);
 }
\ No newline at end of file
@@ -1,7 +1,6 @@
 #include "level.h"
 
-#include "graphics.h"
-#include "utility.h"
+#include "fileio.h"
 #include "game.h"
 #include "entity.h"
 #include "fov.h"
@@ -14,6 +13,9 @@ using namespace glm;
 
 namespace rlf
 {
+	// paths longer than this (in manhattan distance) use the hierarchical pathfinder
+	static constexpr int HIERARCHICAL_PATH_MIN_DISTANCE = 2 * HierarchicalPathFinder::CLUSTER_SIZE;
+
 	void Level::Init(const Array2D<LevelBgElement>& bg, const std::vector<std::pair<DbIndex,EntityDynamicConfig>>& entityCfgs, int locationIndex)
 	{
 		this->bg = bg;
@@ -33,6 +35,10 @@ namespace rlf
 		sig::onObjectStateChanged.connect<Level, &Level::OnObjectStateChanged>(this);
 		sig::onEntityAdded.connect<Level, &Level::OnEntityAdded>(this);
 		sig::onEntityRemoved.connect<Level, &Level::OnEntityRemoved>(this);
+		sig::onEntityMoved.connect<Level, &Level::OnEntityMoved>(this);
+		InvalidatePlayerCaches();
+		RebuildSpatialIndex();
+		RebuildBlockingMaps();
 	}
 
 	void Level::StopListening()
@@ -40,6 +46,7 @@ namespace rlf
 		sig::onObjectStateChanged.disconnect<Level, &Level::OnObjectStateChanged>(this);
 		sig::onEntityAdded.disconnect<Level, &Level::OnEntityAdded>(this);
 		sig::onEntityRemoved.disconnect<Level, &Level::OnEntityRemoved>(this);
+		sig::onEntityMoved.disconnect<Level, &Level::OnEntityMoved>(this);
 	}
 
 	void Level::OnEntityAdded(Entity& entity)
@@ -47,6 +54,14 @@ namespace rlf
 		if (entity.Type() != EntityType::Item)
 		{
 			entities.push_back(entity.Id());
+			LinkEntity(entity);
+			UpdateBlockingMaps(entity.GetLocation().position);
+			// creatures don't affect the approach map or the player's visibility, but the player and objects do
+			if (entity.Type() != EntityType::Creature || Game::Instance().IsPlayer(entity))
+				InvalidatePlayerCaches();
+			// ... unless it's a creature that can see further than what we have cached
+			else if (entity.DbCfg().Cfg()->creatureCfg.lineOfSightRadius > playerVisibilityRadius)
+				isPlayerVisibilityDirty = true;
 			// if it's the player who was added to the level, recalculate visibility
 			if (Game::Instance().IsPlayer(entity))
 				UpdateFogOfWar();
@@ -60,30 +75,129 @@ namespace rlf
 			auto id = entity.Id();
 			// erase-remove idiom, removing all entity IDs that match this entity's id
 			entities.erase(std::remove_if(entities.begin(), entities.end(), [id](const EntityId& eref) { return eref == id; }), entities.end());
+			UnlinkEntity(entity);
+			UpdateBlockingMaps(entity.GetLocation().position);
+			if (entity.Type() != EntityType::Creature)
+				InvalidatePlayerCaches();
 		}
 	}
 
-	bool Level::DoesTileBlockVision(const glm::ivec2& p) const
+	void Level::RebuildSpatialIndex()
 	{
-		// check the background tile
-		if (bg(p.x, p.y).blocksVision)
-			return false;
-		// check all entities on this tile
+		cellHeads = Array2D<int>(bg.Size(), -1);
+		cellLinks.clear();
 		for (const auto& entityId : entities)
 		{
 			auto entity = entityId.Entity();
-			if (entity->GetLocation().position == p && entity->BlocksVision())
-				return false;
+			if (entity != nullptr)
+				LinkEntity(*entity);
+		}
+	}
+
+	void Level::LinkEntity(const Entity& e)
+	{
+		const auto& p = e.GetLocation().position;
+		if (!cellHeads.InBounds(p))
+			return;
+		auto index = e.Id().id;
+		if (index >= int(cellLinks.size()))
+			cellLinks.resize(index + 1);
+		auto& link = cellLinks[index];
+		link.id = e.Id();
+		link.cell = p.x + p.y * bg.Size().x;
+		link.next = -1;
+		// append at the end of the tile's list, so that queries see the entities in the order that they were added (lists are tiny, typically 1-2 entities)
+		auto& head = cellHeads(p.x, p.y);
+		if (head < 0)
+		{
+			link.prev = -1;
+			head = index;
 		}
+		else
+		{
+			int tail = head;
+			while (cellLinks[tail].next >= 0)
+				tail = cellLinks[tail].next;
+			cellLinks[tail].next = index;
+			link.prev = tail;
+		}
+	}
+
+	bool Level::UnlinkEntity(const Entity& e)
+	{
+		// make sure that it's this entity that is linked, and not an older one that used the same pool slot
+		auto index = e.Id().id;
+		if (index >= int(cellLinks.size()) || !(cellLinks[index].id == e.Id()) || cellLinks[index].cell < 0)
+			return false;
+		// remove from the list of the tile that it was stored at, which might not be its current position if it just moved
+		auto& link = cellLinks[index];
+		auto width = bg.Size().x;
+		if (link.prev >= 0)
+			cellLinks[link.prev].next = link.next;
+		else
+			cellHeads(link.cell % width, link.cell / width) = link.next;
+		if (link.next >= 0)
+			cellLinks[link.next].prev = link.prev;
+		link = {};
 		return true;
 	}
 
+	void Level::RebuildBlockingMaps()
+	{
+		auto mapSize = bg.Size();
+		blocksMovementMap = BitArray2D(mapSize);
+		blocksVisionMap = BitArray2D(mapSize);
+		hierarchicalPathFinder.Reset(mapSize);
+		for (auto& cachedPath : cachedPaths)
+			cachedPath.pathPlanner.Reset();
+		regions.Invalidate();
+		for (int y = 0; y < mapSize.y; ++y)
+			for (int x = 0; x < mapSize.x; ++x)
+				UpdateBlockingMaps({ x, y });
+	}
+
+	void Level::UpdateBlockingMaps(const glm::ivec2& p)
+	{
+		if (!bg.InBounds(p))
+			return;
+		// start with the background tile, and add any objects on this tile
+		const auto& bgElement = bg(p.x, p.y);
+		bool blocksMovement = bgElement.blocksMovement;
+		bool blocksVision = bgElement.blocksVision;
+		for (int i = FirstEntityLinkAt(p); i >= 0; i = cellLinks[i].next)
+		{
+			auto entity = cellLinks[i].id.Entity();
+			if (entity != nullptr && entity->Type() == EntityType::Object)
+			{
+				blocksMovement = blocksMovement || entity->BlocksMovement();
+				blocksVision = blocksVision || entity->BlocksVision();
+			}
+		}
+		// e.g. a door opened or closed, so the paths through this tile change
+		if (blocksMovementMap.Get(p) != blocksMovement)
+		{
+			++blockingVersion;
+			for (auto& cachedPath : cachedPaths)
+				cachedPath.pathPlanner.Invalidate(p);
+			hierarchicalPathFinder.Invalidate(p);
+			// opening a tile can only join regions, but blocking one might split a region
+			if (blocksMovement)
+				regions.Invalidate();
+			else
+				regions.OpenTile(p);
+		}
+		blocksMovementMap.Set(p, blocksMovement);
+		blocksVisionMap.Set(p, blocksVision);
+	}
+
 	void Level::UpdateFogOfWar()
 	{
-		// reset the fog of war by turning all previously visible tiles to definitely explored
+		// reset the fog of war by turning all previously visible tiles to definitely explored. These can only be in the previous visible area
 		auto map_size = bg.Size();
-		for (int y = 0; y < map_size.y; ++y)
-			for (int x = 0; x < map_size.x; ++x)
+		auto oldStart = isVisibleRectKnown ? visibleRectStart : glm::ivec2(0, 0);
+		auto oldEnd = isVisibleRectKnown ? visibleRectEnd : map_size;
+		for (int y = oldStart.y; y < oldEnd.y; ++y)
+			for (int x = oldStart.x; x < oldEnd.x; ++x)
 			{
 				// Set everything previously visible to currently explored
 				auto& fowValue = fogOfWar(x, y);
@@ -94,23 +208,35 @@ namespace rlf
 		// Now calculate the field of view, where if a tile is visible, it gets a "Visible" status
 		auto player = Game::Instance().PlayerId().Entity();
 		auto posPlayer = player->GetLocation().position;
-		auto cb_is_opaque = [&](const glm::ivec2& p) {return !DoesTileBlockVision(p); };
-		auto cb_on_visible = [&](const glm::ivec2& p) { fogOfWar(p.x, p.y) = FogOfWarStatus::Visible; };
-		CalculateFieldOfView(player->GetLocation().position, player->DbCfg().Cfg()->creatureCfg.lineOfSightRadius, map_size, cb_is_opaque, cb_on_visible);
+		auto cb_is_opaque = [&](const glm::ivec2& p) {return blocksVisionMap.Get(p); };
+		auto newStart = posPlayer;
+		auto newEnd = posPlayer + 1;
+		auto cb_on_visible = [&](const glm::ivec2& p) { 
+			fogOfWar(p.x, p.y) = FogOfWarStatus::Visible; 
+			newStart = min(newStart, p);
+			newEnd = max(newEnd, p + 1);
+		};
+		ShadowcastFieldOfView(posPlayer, player->DbCfg().Cfg()->creatureCfg.lineOfSightRadius, map_size, cb_is_opaque, cb_on_visible);
+		isVisibleRectKnown = true;
+		visibleRectStart = newStart;
+		visibleRectEnd = newEnd;
 
-		sig::onFogOfWarChanged.fire();
+		// only the union of the old and new visible areas has changed
+		auto changedStart = min(oldStart, newStart);
+		auto changedEnd = max(oldEnd, newEnd);
+		sig::onFogOfWarChanged.fire(changedStart, changedEnd - changedStart);
 	}
 
 	bool Level::EntityCanMoveTo(const Entity& e, const glm::ivec2& position) const
 	{
-		// Check background first, e.g. if it's a wall
-		if (bg(position.x, position.y).blocksMovement)
+		// Check static blockers first, e.g. if it's a wall or a closed door
+		if (!bg.InBounds(position) || blocksMovementMap.Get(position))
 			return false;
-		// check if there are any blocker entities
-		for (const auto& entityId : entities)
+		// check if there are any creatures in the way
+		for (int i = FirstEntityLinkAt(position); i >= 0; i = cellLinks[i].next)
 		{
-			auto entity = entityId.Entity();
-			if (entity != &e && entity->GetLocation().position == position && entity->BlocksMovement())
+			auto entity = cellLinks[i].id.Entity();
+			if (entity != nullptr && entity != &e && entity->Type() == EntityType::Creature)
 				return false;
 		}
 		return true;
@@ -130,17 +256,39 @@ namespace rlf
 		if (distance < 2.0f) 
 			return true; 
 
-		// Calculate a line from the entity to the target
-		// Now keep in mind that your fov function might not always return the same results as the line function, 
-		//	  so make sure they give compatible results if that's important for your game
-		std::vector<glm::ivec2> points;
-		Line(points, start, position);
-		assert(points.size() > 2); // not adjacent, so minimum of 3 points
+		// If we're looking at the player, use the cached field of view from the player's position. It's calculated with symmetric shadowcasting,
+		//	  so if the player's tile can see ours, ours can see the player's, and it gives the same answer as the line test below
+		auto player = Game::Instance().PlayerId().Entity();
+		if (player != nullptr && player != &e && player->GetLocation().position == position)
+		{
+			UpdatePlayerVisibility();
+			return playerVisibility.Get(start);
+		}
+
+		// follow the line between the tile centres. The end points don't block vision
+		return HasSymmetricLineOfSight(start, position, [this](const glm::ivec2& p) { return DoesTileBlockVision(p); });
+	}
 
-		// process all but first/last points, for vision blocking
-		for (int i = 1; i< int(points.size()) - 1; ++i) 
-			if (!DoesTileBlockVision(points[i]))
-				return false;
+	bool Level::IsPlayerVisibilityConsistent() const
+	{
+		auto player = Game::Instance().PlayerId().Entity();
+		if (player == nullptr)
+			return true;
+		UpdatePlayerVisibility();
+		// every tile within the cached radius must be visible in the cached view exactly when there's a line of sight from it to the player
+		const auto& playerPosition = player->GetLocation().position;
+		const auto mapSize = bg.Size();
+		const int radius = playerVisibilityRadius;
+		for (int y = std::max(playerPosition.y - radius, 0); y <= std::min(playerPosition.y + radius, mapSize.y - 1); ++y)
+			for (int x = std::max(playerPosition.x - radius, 0); x <= std::min(playerPosition.x + radius, mapSize.x - 1); ++x)
+			{
+				auto delta = glm::ivec2(x, y) - playerPosition;
+				if (delta.x * delta.x + delta.y * delta.y > radius * radius)
+					continue;
+				auto hasLineOfSight = HasSymmetricLineOfSight(glm::ivec2(x, y), playerPosition, [this](const glm::ivec2& p) { return DoesTileBlockVision(p); });
+				if (hasLineOfSight != playerVisibility.Get(x, y))
+					return false;
+			}
 		return true;
 	}
 
@@ -149,36 +297,282 @@ namespace rlf
 		// bounds check
 		if (!bg.InBounds(position))
 			return nullptr;
-		// go through all entities and check if any of them is at the requested position, if it matches the movement blocking parameter
+		// go through all entities at the requested position, and check if any of them matches the movement blocking parameter
 		//	  so that we can distinguish between creatures and item piles on the same tile for example
-		for (const auto& entityId : entities)
+		for (int i = FirstEntityLinkAt(position); i >= 0; i = cellLinks[i].next)
 		{
-			auto entity = entityId.Entity();
-			if (entity->GetLocation().position == position)
-			{
-				// if it's not set or if it's an item pile or something like that, give priority to what we get here
-				if (entity->BlocksMovement() == blocksMovement)
-					return entity;
-			}
+			auto entity = cellLinks[i].id.Entity();
+			if (entity != nullptr && entity->BlocksMovement() == blocksMovement)
+				return entity;
 		}
 		return nullptr;
 	}
 
 	void Level::OnObjectStateChanged(const Entity& e)
 	{
+		// The change in the object's state might affect what blocks movement or vision on its tile
+		UpdateBlockingMaps(e.GetLocation().position);
 		// The change in the object's state might affect visibility, so Update it for good measure
 		UpdateFogOfWar();
+		// ... and it might also open or close a route towards the player
+		InvalidatePlayerCaches();
+	}
+
+	void Level::OnEntityMoved(const Entity& e)
+	{
+		// move the entity to the list of its new tile
+		auto width = bg.Size().x;
+		auto index = e.Id().id;
+		auto oldCell = index < int(cellLinks.size()) ? cellLinks[index].cell : -1;
+		if (UnlinkEntity(e))
+		{
+			LinkEntity(e);
+			// objects affect the blocking maps on both their old and new tile
+			if (e.Type() == EntityType::Object)
+			{
+				UpdateBlockingMaps({ oldCell % width, oldCell / width });
+				UpdateBlockingMaps(e.GetLocation().position);
+			}
+		}
+		// other creatures are not considered in the approach map, so we only care about the player
+		if (Game::Instance().IsPlayer(e))
+			InvalidatePlayerCaches();
 	}
 
 	std::vector<glm::ivec2> Level::CalcPath(const Entity& e, const glm::ivec2& tgt) const
 	{
-		return CalculatePath(e.GetLocation().position, tgt, bg.Size(), [&](const glm::ivec2& p) { 
-			return EntityCanMoveTo(e, p) ? 1.0f : std::numeric_limits<float>::infinity(); 
+		return CalcPathFrom(e, e.GetLocation().position, tgt);
+	}
+
+	std::vector<glm::ivec2> Level::CalcPathFrom(const Entity& e, const glm::ivec2& start, const glm::ivec2& tgt) const
+	{
+		// every step costs the same, so we can use jump point search. The blockers are the same as in EntityCanMoveTo: the static ones, and the other creatures
+		// don't search at all if the target is in a different region, e.g. across water or behind a closed door
+		if (!IsReachable(start, tgt))
+			return {};
+		pathBlockedMap = blocksMovementMap;
+		for (const auto& entityId : entities)
+		{
+			auto entity = entityId.Entity();
+			if (entity != nullptr && entity != &e && entity->Type() == EntityType::Creature && pathBlockedMap.InBounds(entity->GetLocation().position))
+				pathBlockedMap.Set(entity->GetLocation().position, true);
+		}
+		// the start can be a tile further along a path, where another creature stands right now
+		if (start != e.GetLocation().position && pathBlockedMap.InBounds(start))
+			pathBlockedMap.Set(start, blocksMovementMap.Get(start));
+
+		// long paths are planned with the hierarchical pathfinder on the static blockers, and only the first stretch is refined with the creatures in the way
+		auto delta = glm::abs(tgt - start);
+		if (delta.x + delta.y > HIERARCHICAL_PATH_MIN_DISTANCE)
+		{
+			auto path = hierarchicalPathFinder.CalculatePath(start, tgt, blocksMovementMap);
+			// unreachable, even without any creatures in the way
+			if (path.empty())
+				return path;
+			const int waypointIndex = std::min(int(path.size()) - 1, HierarchicalPathFinder::CLUSTER_SIZE);
+			auto refinedPath = pathFinder.CalculatePath(start, path[waypointIndex], pathBlockedMap);
+			if (!refinedPath.empty())
+			{
+				refinedPath.insert(refinedPath.end(), path.begin() + waypointIndex + 1, path.end());
+				return refinedPath;
+			}
+			// creatures block the way to the waypoint, so search the whole path
+		}
+		return pathFinder.CalculatePath(start, tgt, pathBlockedMap);
+	}
+
+	bool Level::IsReachable(const glm::ivec2& from, const glm::ivec2& to) const
+	{
+		if (!bg.InBounds(from) || !bg.InBounds(to))
+			return false;
+		// a neighbour can always be stepped into (or attacked)
+		auto delta = glm::abs(to - from);
+		if (delta.x + delta.y <= 1)
+			return true;
+		if (regions.IsDirty())
+			regions.Calculate(blocksMovementMap);
+		// blocked tiles can still be the ends of a path (e.g. walking up to a closed door), so they belong to all the regions around them
+		const auto fnAnyRegion = [this](const glm::ivec2& p, const auto& fnPredicate) {
+			auto region = regions.Region(p);
+			if (region >= 0)
+				return fnPredicate(region);
+			for (const auto& nb : Nb4())
+			{
+				region = regions.Region(p + nb);
+				if (region >= 0 && fnPredicate(region))
+					return true;
+			}
+			return false;
+		};
+		return fnAnyRegion(from, [&](int fromRegion) {
+			return fnAnyRegion(to, [fromRegion](int toRegion) { return toRegion == fromRegion; });
 		});
 	}
 
+	void Level::UpdateApproachMap() const
+	{
+		if (!isApproachMapDirty)
+			return;
+		isApproachMapDirty = false;
+		auto player = Game::Instance().PlayerId().Entity();
+		if (player == nullptr)
+			return;
+
+		// Only the static blockers are considered (bg and objects such as closed doors).
+		// Creatures are treated as passable: they move around, and we don't want a single goblin in a corridor to cut off everybody behind it
+		approachMap.Calculate({ player->GetLocation().position }, bg.Size(), [this](const glm::ivec2& p) {
+			return blocksMovementMap.Get(p) ? std::numeric_limits<float>::infinity() : 1.0f;
+		});
+	}
+
+	void Level::InvalidatePlayerCaches()
+	{
+		isApproachMapDirty = true;
+		isPlayerVisibilityDirty = true;
+	}
+
+	void Level::UpdatePlayerVisibility() const
+	{
+		if (!isPlayerVisibilityDirty)
+			return;
+		isPlayerVisibilityDirty = false;
+		auto player = Game::Instance().PlayerId().Entity();
+		if (player == nullptr)
+			return;
+
+		// the cached area needs to cover the creature that sees the furthest
+		playerVisibilityRadius = 0;
+		for (const auto& entityId : entities)
+		{
+			auto entity = entityId.Entity();
+			if (entity != nullptr && entity != player && entity->Type() == EntityType::Creature)
+				playerVisibilityRadius = glm::max(playerVisibilityRadius, entity->DbCfg().Cfg()->creatureCfg.lineOfSightRadius);
+		}
+
+		// the FOV excludes tiles at exactly the radius, while creatures can see at exactly their radius, so add 1. Creatures check their own radius anyway
+		playerVisibility = BitArray2D(bg.Size());
+		SymmetricShadowcastFieldOfView(player->GetLocation().position, playerVisibilityRadius + 1, bg.Size(), 
+			[this](const glm::ivec2& p) { return blocksVisionMap.Get(p); },
+			[this](const glm::ivec2& p) { playerVisibility.Set(p, true); });
+	}
+
+	void Level::CreaturesThatSeePlayer(std::vector<EntityId>& creatures) const
+	{
+		creatures.resize(0);
+		auto player = Game::Instance().PlayerId().Entity();
+		if (player == nullptr)
+			return;
+		auto playerPosition = player->GetLocation().position;
+		for (const auto& entityId : entities)
+		{
+			auto entity = entityId.Entity();
+			if (entity != nullptr && entity != player && entity->Type() == EntityType::Creature && EntityHasLineOfSightTo(*entity, playerPosition))
+				creatures.push_back(entityId);
+		}
+	}
+
+	glm::ivec2 Level::NextPositionTowardsPlayer(const Entity& e) const
+	{
+		auto position = e.GetLocation().position;
+		auto player = Game::Instance().PlayerId().Entity();
+		if (player == nullptr)
+			return position;
+		auto playerPosition = player->GetLocation().position;
+		UpdateApproachMap();
+
+		// walk downhill: pick the best neighbour that is closer to the player and that we can step on (or bump into, if it's the player)
+		std::array<glm::ivec2, 4> candidates;
+		const int numCandidates = approachMap.DownhillNeighbours(candidates, position);
+		for (int i = 0; i < numCandidates; ++i)
+			if (candidates[i] == playerPosition || EntityCanMoveTo(e, candidates[i]))
+				return candidates[i];
+
+		// All the ways downhill are taken by other creatures. Try to find a way around them
+		if (numCandidates > 0)
+			return NextStepTowards(e, playerPosition);
+		return position;
+	}
+
+	glm::ivec2 Level::NextStepTowards(const Entity& e, const glm::ivec2& tgt) const
+	{
+		auto position = e.GetLocation().position;
+		if (position == tgt)
+			return position;
+		auto index = e.Id().id;
+		if (index >= int(cachedPaths.size()))
+			cachedPaths.resize(index + 1);
+		auto& cachedPath = cachedPaths[index];
+
+		// the cached path is still good if it's for this entity, nothing got blocked or unblocked since, and the entity followed it so far
+		bool isValid = cachedPath.id == e.Id() && cachedPath.blockingVersion == blockingVersion && cachedPath.next < int(cachedPath.path.size());
+		if (isValid)
+		{
+			auto expectedPosition = cachedPath.next == 0 ? cachedPath.start : cachedPath.path[cachedPath.next - 1];
+			isValid = expectedPosition == position && RepairCachedPath(e, cachedPath, tgt);
+		}
+		// other creatures are not part of the blocking version, as they move all the time. Only the next step needs to be free, as the rest of the path is checked on the next turns
+		if (isValid)
+		{
+			const auto& nextStep = cachedPath.path[cachedPath.next];
+			isValid = nextStep == tgt || EntityCanMoveTo(e, nextStep);
+		}
+
+		if (!isValid)
+		{
+			// the search of another entity that used the same slot is no use
+			if (!(cachedPath.id == e.Id()))
+				cachedPath.pathPlanner.Reset();
+			cachedPath.id = e.Id();
+			cachedPath.blockingVersion = blockingVersion;
+			cachedPath.start = position;
+			cachedPath.goal = tgt;
+			cachedPath.next = 0;
+			// plan around the static blockers with the entity's incremental search, which continues from the previous turns. If another creature is in the way, search around it from scratch
+			cachedPath.path.clear();
+			if (IsReachable(position, tgt) && !blocksMovementMap.Get(tgt))
+				cachedPath.path = cachedPath.pathPlanner.CalculatePath(position, tgt, blocksMovementMap);
+			if (cachedPath.path.empty() || (cachedPath.path.front() != tgt && !EntityCanMoveTo(e, cachedPath.path.front())))
+				cachedPath.path = CalcPath(e, tgt);
+			if (cachedPath.path.empty())
+				return position;
+		}
+		return cachedPath.path[cachedPath.next++];
+	}
+
+	bool Level::RepairCachedPath(const Entity& e, CachedPath& cachedPath, const glm::ivec2& tgt) const
+	{
+		auto& path = cachedPath.path;
+		auto drift = glm::abs(tgt - cachedPath.goal);
+		auto driftDistance = drift.x + drift.y;
+		if (driftDistance == 0)
+			return true;
+		cachedPath.goal = tgt;
+		// the target moved onto the rest of the path (e.g. it doubled back), so the path just ends there. Otherwise the path would loop around the target's detours
+		auto itTarget = std::find(path.begin() + cachedPath.next, path.end(), tgt);
+		if (itTarget != path.end())
+		{
+			path.erase(itTarget + 1, path.end());
+			return true;
+		}
+		// the target took a step away from the path: follow it with one more step
+		if (driftDistance == 1)
+		{
+			path.push_back(tgt);
+			return true;
+		}
+		// the target moved further: keep the path up to as many tiles before its end as the target moved, and search from there
+		const int keep = std::max(cachedPath.next, int(path.size()) - driftDistance);
+		auto repairStart = keep == cachedPath.next ? e.GetLocation().position : path[keep - 1];
+		auto repair = CalcPathFrom(e, repairStart, tgt);
+		if (repair.empty())
+			return false;
+		path.resize(keep);
+		path.insert(path.end(), repair.begin(), repair.end());
+		return true;
+	}
+
 
-	std::pair<Array2D<LevelBgElement>, std::vector<std::pair<DbIndex, EntityDynamicConfig>>> LoadLevelFromTxtFile(const std::string& filename)
+	std::pair<Array2D<LevelBgElement>, std::vector<std::pair<DbIndex, EntityDynamicConfig>>> LoadLevelFromTxtFile(const std::string& filename, Rng& rng)
 	{	
 		static const LevelBgElement bgFloor = { "floor", false, false, false, '.', glm::vec4(.7, .7, .7, 1) };
 		static const LevelBgElement bgWall = { "wall", true, true, false, '#', glm::vec4(.7, .7, .7, 1) };
@@ -252,13 +646,13 @@ namespace rlf
 		};
 		for (int i = 0; i < 10; ++i)
 		{
-			auto x = rand()%width;
-			auto y = rand() % height;
+			auto x = rng.Below(width);
+			auto y = rng.Below(height);
 			ivec2 p = { x,y };
 			if (!bg(x, y).blocksMovement && std::find_if(entityCfgs.begin(), entityCfgs.end(), [&](const auto& dbi_dcfg) { return dbi_dcfg.second.position == p; }) == entityCfgs.end())
 			{
 				EntityDynamicConfig dcfg{ p };
-				dcfg.inventory.emplace_back(spawnableItems[rand()% spawnableItems.size()]);
+				dcfg.inventory.emplace_back(spawnableItems[rng.Below(int(spawnableItems.size()))]);
 				entityCfgs.emplace_back(DbIndex::ItemPile(), dcfg);
 			}
 				
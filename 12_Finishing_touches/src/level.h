@@ -8,7 +8,14 @@
 #include "sparsebuffer.h"
 #include "spritemap.h"
 #include "entity.h"
+#include "astar.h"
+#include "hpa.h"
+#include "dstarlite.h"
+#include "regions.h"
+#include "dijkstra.h"
+#include "rng.h"
 #include "array2d.h"
+#include "bitarray2d.h"
 
 namespace rlf
 {
@@ -32,6 +39,31 @@ namespace rlf
 		glm::vec4 color = { 1, 1, 1, 1 }; // glyph color, defaults to white
 	};
 
+	// A node in the per-tile entity lists of a level. Nodes are indexed by the entity's pool index, and prev/next link entities on the same tile (-1 for none)
+	struct EntityCellLink
+	{
+		EntityId id;
+		int cell = -1; // tile index (x + y * width), or -1 if the entity is not in the index
+		int prev = -1;
+		int next = -1;
+	};
+
+	// A path that an entity is following, kept between turns so that it doesn't need to be searched again every step
+	struct CachedPath
+	{
+		EntityId id;
+		// the level's blocking version when the path was calculated. Any change in the static blockers makes the path out of date
+		int blockingVersion = -1;
+		// where the entity was when the path was calculated, and where the path leads to
+		glm::ivec2 start = { 0,0 };
+		glm::ivec2 goal = { 0,0 };
+		std::vector<glm::ivec2> path;
+		// index of the next step in the path
+		int next = 0;
+		// the entity's incremental search around the static blockers, kept up to date with the tiles that change, to plan the path again cheaply when it's out of date
+		IncrementalPathFinder pathPlanner;
+	};
+
 	// Represents a game level
 	class Level
 	{
@@ -40,12 +72,12 @@ namespace rlf
 		~Level() { StopListening(); }
 		
 		const Array2D<LevelBgElement>& Bg() const { return bg; }
-		const Array2D<FogOfWarStatus> FogOfWar() const { return fogOfWar; }
+		const Array2D<FogOfWarStatus>& FogOfWar() const { return fogOfWar; }
 		const std::vector<EntityId>& Entities() const { return entities; }
 
 		// initialize the level with data
 		void Init(const Array2D<LevelBgElement>& data, const std::vector<std::pair<DbIndex, EntityDynamicConfig>>& entityCfgs, int locationIndex);
-		// update the fog of war map
+		// update the fog of war map. Only the area around the previous and current field of view is touched
 		void UpdateFogOfWar();
 		// check if an entity can move to a target position
 		bool EntityCanMoveTo(const Entity& e, const glm::ivec2& position) const;
@@ -55,6 +87,17 @@ namespace rlf
 		Entity* GetEntity(const glm::ivec2& position, bool blocksMovement) const;
 		// calculate a path between an entity and a target position
 		std::vector<glm::ivec2> CalcPath(const Entity& e, const glm::ivec2& tgt) const;
+		// check if there can be a path between two positions, considering only the static blockers (walls, closed doors, etc). Answered in constant time from the connected regions of the level
+		bool IsReachable(const glm::ivec2& from, const glm::ivec2& to) const;
+		// get the next position on a path from an entity towards a target position, or its own position if there's no path.
+		// The path is cached per entity, and reused on the next calls while the static blockers don't change and the target only moves a little
+		glm::ivec2 NextStepTowards(const Entity& e, const glm::ivec2& tgt) const;
+		// get all creatures (except the player) that can see the player. This is answered from a single cached field of view, calculated from the player's position
+		void CreaturesThatSeePlayer(std::vector<EntityId>& creatures) const;
+		// check that the cached field of view from the player agrees with the line of sight test from every tile around the player. For regression runs
+		bool IsPlayerVisibilityConsistent() const;
+		// get the next position that an entity should move to in order to approach the player, or its own position if there's nowhere to go
+		glm::ivec2 NextPositionTowardsPlayer(const Entity& e) const;
 		// start listening to events
 		void StartListening();
 		// stop listening to events
@@ -65,14 +108,39 @@ namespace rlf
 		void OnEntityAdded(Entity& entity);
 		void OnEntityRemoved(Entity& e);
 		void OnObjectStateChanged(const Entity& e);
+		void OnEntityMoved(const Entity& e);
 
-		// Does this tile block vision? Check the bg element and all entities standing on that tile
-		bool DoesTileBlockVision(const glm::ivec2& p) const;
+		// mark everything that we cache about the player's surroundings as out of date
+		void InvalidatePlayerCaches();
+		// recalculate the distance map towards the player, if it's out of date
+		void UpdateApproachMap() const;
+		// recalculate the field of view from the player's position, if it's out of date
+		void UpdatePlayerVisibility() const;
+
+		// spatial index maintenance
+		void RebuildSpatialIndex();
+		void LinkEntity(const Entity& e);
+		bool UnlinkEntity(const Entity& e); // returns false if the entity was not in the index
+		// get the index of the first link on a tile, or -1 if there are no entities there. Follow with cellLinks[i].next
+		int FirstEntityLinkAt(const glm::ivec2& p) const { return cellHeads(p.x, p.y); }
+
+		// Does this tile block vision? This includes the bg element and all objects standing on that tile
+		bool DoesTileBlockVision(const glm::ivec2& p) const { return blocksVisionMap.Get(p); }
+
+		// blocking maps maintenance
+		void RebuildBlockingMaps();
+		void UpdateBlockingMaps(const glm::ivec2& p);
+
+		// calculate a path for an entity, as if it was standing at a start position
+		std::vector<glm::ivec2> CalcPathFrom(const Entity& e, const glm::ivec2& start, const glm::ivec2& tgt) const;
+		// bring a cached path up to date with a target that moved, by appending to it or searching again from near its end. Return false if it can't be repaired
+		bool RepairCachedPath(const Entity& e, CachedPath& cachedPath, const glm::ivec2& tgt) const;
 	private:
 
 		// friends for easy serialization
 		friend void from_json(const nlohmann::json& j, Level& level);
 		friend void to_json(nlohmann::json& j, const Level& level);
+		friend class BinarySave;
 
 		// the 2d array of bg elements
 		Array2D<LevelBgElement> bg;
@@ -80,8 +148,41 @@ namespace rlf
 		Array2D<FogOfWarStatus> fogOfWar;
 		// the list of entities (creatures/objects) in the level
 		std::vector<EntityId> entities;
+
+		// NON SERIALIZABLE DATA
+
+		// pathfinding scratch data, reused by every CalcPath query on this level. Mutable, as it's just a cache and doesn't change the level
+		mutable PathFinder pathFinder;
+		// scratch map of the tiles that block a path query
+		mutable BitArray2D pathBlockedMap;
+		// hierarchical pathfinding data for long paths, kept up to date with the static blockers
+		mutable HierarchicalPathFinder hierarchicalPathFinder;
+		// connected regions of the tiles that don't block movement. Recalculated lazily, when a tile gets blocked
+		mutable RegionMap regions;
+		// the paths that entities are following, indexed by the entity's pool index
+		mutable std::vector<CachedPath> cachedPaths;
+		// incremented every time a tile changes between blocking movement or not, so cached paths can tell if they're out of date
+		int blockingVersion = 0;
+		// distances to the player, shared by all creatures that chase the player. Recalculated lazily after the player moves or the level changes
+		mutable DistanceMap approachMap;
+		mutable bool isApproachMapDirty = true;
+		// tiles visible from the player's position, up to the largest line of sight radius of the creatures in the level
+		mutable BitArray2D playerVisibility;
+		mutable int playerVisibilityRadius = 0;
+		mutable bool isPlayerVisibilityDirty = true;
+		// spatial index of entities: for each tile, the first link of the list of entities standing there (-1 if none)
+		Array2D<int> cellHeads;
+		// the links of the per-tile lists, indexed by the entity's pool index
+		std::vector<EntityCellLink> cellLinks;
+		// static blockers for each tile: the bg element combined with any objects on it (e.g. closed doors). Creatures are not included, as they move around
+		BitArray2D blocksMovementMap;
+		BitArray2D blocksVisionMap;
+		// bounding box of the tiles that are currently Visible in the fog of war map, as (start, end) with end exclusive. Unknown after loading
+		bool isVisibleRectKnown = false;
+		glm::ivec2 visibleRectStart = { 0,0 };
+		glm::ivec2 visibleRectEnd = { 0,0 };
 	};
 
-	// helper to load a level from a text file
-	std::pair<Array2D<LevelBgElement>, std::vector<std::pair<DbIndex, EntityDynamicConfig>>> LoadLevelFromTxtFile(const std::string& filename);
+	// helper to load a level from a text file. Some random treasure is added, using the given generator
+	std::pair<Array2D<LevelBgElement>, std::vector<std::pair<DbIndex, EntityDynamicConfig>>> LoadLevelFromTxtFile(const std::string& filename, Rng& rng);
 }
\ No newline at end of file
@@ -10,12 +10,21 @@ using namespace rlf;
 
 class GameApp : public rlf::FrameworkApp
 {
+public:
+	GameApp()
+	{
+		// This is a turn-based game, so nothing changes on screen until we get input: render only when needed
+		settings.renderOnDemand = true;
+	}
+
+private:
 	// Put here any initialisation code. Happens once, before the main loop and after initialisation of GLFW/GLEW/ImGui
 	void onInit() override
 	{
 		// we can map this to a key for dynamic database reload!
 		Db::Instance().LoadFromDisk();
 		Graphics::Instance().Init();
+		Game::Instance().SetRenderer(Graphics::Instance());
 		Game::Instance().Init();
 	}
 
@@ -0,0 +1,93 @@
+#include "regions.h"
+
+#include "grid.h"
+
+using namespace glm;
+
+namespace rlf
+{
+	int RegionMap::Find(int label) const
+	{
+		// find the representative, then point everything on the way directly to it
+		int root = label;
+		while (parents[root] != root)
+			root = parents[root];
+		while (parents[label] != root)
+		{
+			auto next = parents[label];
+			parents[label] = root;
+			label = next;
+		}
+		return root;
+	}
+
+	void RegionMap::Union(int labelA, int labelB)
+	{
+		auto rootA = Find(labelA);
+		auto rootB = Find(labelB);
+		// the lower label becomes the representative
+		if (rootA < rootB)
+			parents[rootB] = rootA;
+		else if (rootB < rootA)
+			parents[rootA] = rootB;
+	}
+
+	void RegionMap::Calculate(const BitArray2D& blocked)
+	{
+		const auto& size = blocked.Size();
+		labels = Array2D<int>(size, -1);
+		parents.clear();
+		// scan the rows: each open tile joins the region of the tile to its left and/or above. If both exist, the two regions are the same
+		for (int y = 0; y < size.y; ++y)
+			for (int x = 0; x < size.x; ++x)
+			{
+				if (blocked.Get(x, y))
+					continue;
+				const int left = x > 0 ? labels(x - 1, y) : -1;
+				const int up = y > 0 ? labels(x, y - 1) : -1;
+				int label;
+				if (left < 0 && up < 0)
+				{
+					label = int(parents.size());
+					parents.push_back(label);
+				}
+				else
+				{
+					label = left >= 0 ? left : up;
+					if (left >= 0 && up >= 0)
+						Union(left, up);
+				}
+				labels(x, y) = label;
+			}
+		// point every tile directly to its region
+		for (int y = 0; y < size.y; ++y)
+			for (int x = 0; x < size.x; ++x)
+				if (labels(x, y) >= 0)
+					labels(x, y) = Find(labels(x, y));
+		isDirty = false;
+	}
+
+	void RegionMap::OpenTile(const ivec2& p)
+	{
+		if (isDirty || !labels.InBounds(p) || labels(p.x, p.y) >= 0)
+			return;
+		int label = -1;
+		for (const auto& nb : Nb4())
+		{
+			auto nbRegion = Region(p + nb);
+			if (nbRegion < 0)
+				continue;
+			if (label < 0)
+				label = nbRegion;
+			else
+				Union(label, nbRegion);
+		}
+		// no open neighbours: a new region
+		if (label < 0)
+		{
+			label = int(parents.size());
+			parents.push_back(label);
+		}
+		labels(p.x, p.y) = label;
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include <array2d.h>
+#include <bitarray2d.h>
+
+namespace rlf
+{
+	// Connected regions of the open tiles of a map: two open tiles have the same region if there's a 4-connected path of open tiles between them.
+	// Regions are labelled in a single scan, merging the labels with union-find. Opening a tile merges regions cheaply, but blocking one can split a region, so it needs a new scan
+	class RegionMap
+	{
+	public:
+		// Label all the regions of a map
+		void Calculate(const BitArray2D& blocked);
+		// A tile became open: join it with the regions around it
+		void OpenTile(const glm::ivec2& p);
+		// A tile became blocked: the labels are out of date until calculated again
+		void Invalidate() { isDirty = true; }
+		bool IsDirty() const { return isDirty; }
+
+		// Get the region of a tile, or -1 if it's blocked or out of the map
+		int Region(const glm::ivec2& p) const { return labels.InBounds(p) && labels(p.x, p.y) >= 0 ? Find(labels(p.x, p.y)) : -1; }
+
+	private:
+		// union-find over the labels: get the representative label, and join two labels
+		int Find(int label) const;
+		void Union(int labelA, int labelB);
+
+	private:
+		// the label of each tile, or -1 for blocked tiles. The region is the representative label
+		Array2D<int> labels;
+		// the parent of each label. A label is a representative if it's its own parent. Mutable, for path compression
+		mutable std::vector<int> parents;
+		bool isDirty = true;
+	};
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace rlf
+{
+	// The rendering functionality that the game logic needs. Graphics implements this, and headless builds use the null renderer, so that the game logic doesn't depend on OpenGL
+	class IRenderer
+	{
+	public:
+		virtual ~IRenderer() = default;
+
+		// Begin/end rendering a frame
+		virtual void BeginRender() = 0;
+		virtual void EndRender() = 0;
+		// Make the view follow a point, usually the player's position
+		virtual void CenterCameraAtPoint(const glm::ivec2& point) = 0;
+		// Reload any shaders
+		virtual void ReloadShaders() = 0;
+	};
+
+	// A renderer that does nothing. Used when running without a window, e.g. for simulations
+	class NullRenderer : public IRenderer
+	{
+	public:
+		static NullRenderer& Instance() { static NullRenderer instance; return instance; }
+
+		void BeginRender() override {}
+		void EndRender() override {}
+		void CenterCameraAtPoint(const glm::ivec2& point) override {}
+		void ReloadShaders() override {}
+	};
+}
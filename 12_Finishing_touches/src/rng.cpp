@@ -0,0 +1,12 @@
+#include "rng.h"
+
+#include <random>
+
+namespace rlf
+{
+	uint64_t RandomSeed()
+	{
+		std::random_device rd;
+		return (uint64_t(rd()) << 32u) | rd();
+	}
+}
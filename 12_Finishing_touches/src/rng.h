@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json_fwd.hpp>
+
+namespace rlf
+{
+	// The subsystems that draw random numbers during play. Each one has its own stream, so that e.g. extra combat rolls don't change what the AI does
+	enum class RngStream
+	{
+		Combat = 0,
+		Ai,
+		Num
+	};
+
+	// A PCG32 random number generator (https://www.pcg-random.org): 64 bits of state, fast, and with 2^63 independent streams for the same seed.
+	// Results are the same on every platform, so a seed reproduces a game exactly
+	class Rng
+	{
+	public:
+		using result_type = uint32_t;
+
+		Rng() : Rng(0, 0) {}
+
+		// Create a generator using a seed and a stream index. Different streams with the same seed give unrelated sequences
+		Rng(uint64_t seed, uint64_t stream)
+			:increment((stream << 1u) | 1u)
+		{
+			Next();
+			state += seed;
+			Next();
+		}
+
+		// Get the next 32-bit random number
+		uint32_t Next()
+		{
+			auto oldState = state;
+			state = oldState * 6364136223846793005ULL + increment;
+			auto xorShifted = uint32_t(((oldState >> 18u) ^ oldState) >> 27u);
+			auto rotation = uint32_t(oldState >> 59u);
+			return (xorShifted >> rotation) | (xorShifted << ((32u - rotation) & 31u));
+		}
+
+		// Get a uniformly distributed integer in [0, n). n must be positive. Uses Lemire's multiply-and-reject method, so there's no modulo bias
+		int Below(int n)
+		{
+			auto bound = uint32_t(n);
+			auto m = uint64_t(Next()) * bound;
+			auto low = uint32_t(m);
+			if (low < bound)
+			{
+				auto threshold = (0u - bound) % bound;
+				while (low < threshold)
+				{
+					m = uint64_t(Next()) * bound;
+					low = uint32_t(m);
+				}
+			}
+			return int(m >> 32u);
+		}
+
+		// Shuffle a vector (Fisher-Yates). Unlike std::shuffle, the result doesn't depend on the standard library implementation
+		template<class T>
+		void Shuffle(std::vector<T>& values)
+		{
+			for (int i = int(values.size()) - 1; i > 0; --i)
+				std::swap(values[i], values[Below(i + 1)]);
+		}
+
+		// UniformRandomBitGenerator interface, for use with the standard library
+		static constexpr result_type min() { return 0; }
+		static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+		result_type operator()() { return Next(); }
+
+	private:
+		// friends for easy serialization
+		friend void from_json(const nlohmann::json& j, Rng& rng);
+		friend void to_json(nlohmann::json& j, const Rng& rng);
+		friend class BinarySave;
+
+	private:
+		uint64_t state = 0;
+		// the stream selector; always odd
+		uint64_t increment = 1;
+	};
+
+	// Get a seed from a non-deterministic source, for new games
+	uint64_t RandomSeed();
+}
@@ -6,7 +6,7 @@ namespace rlf
 	Nano::Signal<void(Entity&)> sig::onEntityAdded;
 	Nano::Signal<void(Entity&)> sig::onEntityRemoved;
 	Nano::Signal<void(const Level&)> sig::onLevelChanged;
-	Nano::Signal<void()> sig::onFogOfWarChanged;
+	Nano::Signal<void(const glm::ivec2&, const glm::ivec2&)> sig::onFogOfWarChanged;
 	Nano::Signal<void(const Entity&)> sig::onObjectStateChanged;
 	Nano::Signal<void()> sig::onGuiUpdated;
 	Nano::Signal<void()> sig::onPlayerDied;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <nano_signal_slot.hpp>
+#include <glm/glm.hpp>
 
 namespace rlf
 {
@@ -13,7 +14,7 @@ namespace rlf
 		static Nano::Signal<void(Entity&)> onEntityAdded;
 		static Nano::Signal<void(Entity&)> onEntityRemoved;
 		static Nano::Signal<void(const Level&)> onLevelChanged;
-		static Nano::Signal<void()> onFogOfWarChanged;
+		static Nano::Signal<void(const glm::ivec2&, const glm::ivec2&)> onFogOfWarChanged; // the changed rectangle, as (start, size)
 		static Nano::Signal<void(const Entity&)> onObjectStateChanged;
 		static Nano::Signal<void()> onPlayerDied;
 		static Nano::Signal<void()> onGuiUpdated;
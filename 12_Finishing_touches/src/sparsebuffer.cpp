@@ -1,6 +1,8 @@
 #include "sparsebuffer.h"
 
 #include <cassert>
+#include <cstring>
+#include <iostream>
 
 #include <gl/glew.h>
 
@@ -11,91 +13,232 @@ namespace rlf
 	void SparseBuffer::Init(int stride, int numElementsMax)
 	{
 		assert(buffer == 0);
-		numElementsMax = 1024;
-		buffer = rlf::CreateBuffer(numElementsMax *stride, nullptr, GL_DYNAMIC_DRAW);
 		this->stride = stride;
-		this->numElementsMax = numElementsMax;
+		numElements = 0;
+		currentSection = 0;
+		dirtyBegin.fill(0);
+		dirtyEnd.fill(0);
+		Allocate(glm::max(numElementsMax, 1));
 	}
 
-	// Add some data (num bytes == stride) at a free index and return the slot
+	void SparseBuffer::Allocate(int capacity)
+	{
+		// each section must start at an offset that we can bind as a shader storage buffer
+		GLint alignment = 1;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		const int newSectionBytes = ((capacity * stride + alignment - 1) / alignment) * alignment;
+
+		// create immutable storage and map it once, for the lifetime of the buffer. Coherent, so we don't need to flush our writes explicitly
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLuint newBuffer = 0;
+		glCreateBuffers(1, &newBuffer);
+		glNamedBufferStorage(newBuffer, GLsizeiptr(newSectionBytes) * NUM_SECTIONS, nullptr, flags);
+		auto newMappedMemory = static_cast<uint8_t*>(glMapNamedBufferRange(newBuffer, 0, GLsizeiptr(newSectionBytes) * NUM_SECTIONS, flags));
+
+		if (buffer != 0)
+		{
+			// copy each old section to the start of the new one on the GPU, so that the dirty ranges stay valid
+			for (int i = 0; i < NUM_SECTIONS; ++i)
+				glCopyNamedBufferSubData(buffer, newBuffer, GLintptr(i) * sectionBytes, GLintptr(i) * newSectionBytes, GLsizeiptr(numElementsMax) * stride);
+			// the copies must finish before we write to the new memory from the CPU. Fences are in order, so this also covers any older draws
+			for (auto& fence : fences)
+			{
+				if (fence != nullptr)
+					glDeleteSync(GLsync(fence));
+				fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			}
+			// the old buffer can go. GL keeps it alive until the commands that use it are done
+			glUnmapNamedBuffer(buffer);
+			DeleteBuffer(buffer);
+		}
+		else
+			memset(newMappedMemory, 0, size_t(newSectionBytes) * NUM_SECTIONS);
+
+		buffer = newBuffer;
+		mappedMemory = newMappedMemory;
+		sectionBytes = newSectionBytes;
+		numElementsMax = capacity;
+		shadow.resize(size_t(capacity) * stride, 0);
+	}
+
+	void SparseBuffer::Reserve(int numElementsRequired)
+	{
+		if (numElementsRequired <= numElementsMax)
+			return;
+		auto capacity = numElementsMax;
+		while (capacity < numElementsRequired)
+			capacity *= 2;
+		Allocate(capacity);
+	}
+
+	// Add some data (num bytes == stride) at the end, and return a handle to it
 	int SparseBuffer::Add(const void* data)
 	{
-		// calculate the slot for the data
-		int slot = -1;
-		if (freeSlots.empty())
+		Reserve(numElements + 1);
+
+		// get a free handle: reuse the most recently freed one, or make a new one
+		int handle = -1;
+		if (freeHandles.empty())
 		{
-			slot = firstFreeSlotAtEnd;
-			++firstFreeSlotAtEnd;
+			handle = int(handleToElement.size());
+			handleToElement.push_back(-1);
 		}
 		else
 		{
-			// get last free set element
-			auto it = (freeSlots.end()--);
-			slot = *it;
-			freeSlots.erase(it);
+			handle = freeHandles.back();
+			freeHandles.pop_back();
 		}
 
-		// Update the data and return the slot
-		Update(slot, data);
-		return slot;
+		// the data always goes at the end of the packed elements
+		const int element = numElements++;
+		handleToElement[handle] = element;
+		if (int(elementToHandle.size()) < numElements)
+			elementToHandle.resize(numElements, -1);
+		elementToHandle[element] = handle;
+
+		// Update the data and return the handle
+		Update(handle, data);
+		return handle;
 	}
 
-	void SparseBuffer::Update(int idx, const void* data)
+	void SparseBuffer::Update(int handle, const void* data)
 	{
-		rlf::UpdateSSBO(buffer, idx *stride, stride, data);
+		const int element = handleToElement.at(handle);
+		assert(element >= 0);
+		memcpy(shadow.data() + size_t(element) * stride, data, stride);
+		MarkDirty(element, 1);
 	}
 
 	void SparseBuffer::Set(int numElements, const void* data)
 	{
-		numElements = glm::min(numElements, numElementsMax);
-		auto mem = MapMemory(GL_MAP_WRITE_BIT);
-		memcpy(mem, data, numElements * stride);
-		UnmapMemory();
-		freeSlots.clear();
-		firstFreeSlotAtEnd = numElements;
+		Reserve(numElements);
+		memcpy(shadow.data(), data, size_t(numElements) * stride);
+		MarkDirty(0, numElements);
+		// all handles are gone
+		handleToElement.clear();
+		freeHandles.clear();
+		elementToHandle.assign(numElements, -1);
+		this->numElements = numElements;
 	}
 
-	void SparseBuffer::Remove(int idx)
+	void SparseBuffer::Remove(int handle)
 	{
-		freeSlots.insert(idx);
-		auto memory = MapMemory(GL_MAP_WRITE_BIT);
-		memset((char*)memory+ firstFreeSlotAtEnd * stride, 0, stride);
-		UnmapMemory();
+		const int element = handleToElement.at(handle);
+		assert(element >= 0);
+		// fill the hole with the last element, so that the elements stay packed
+		const int lastElement = numElements - 1;
+		if (element != lastElement)
+		{
+			memcpy(shadow.data() + size_t(element) * stride, shadow.data() + size_t(lastElement) * stride, stride);
+			MarkDirty(element, 1);
+			const int movedHandle = elementToHandle[lastElement];
+			elementToHandle[element] = movedHandle;
+			if (movedHandle >= 0)
+				handleToElement[movedHandle] = element;
+		}
+		elementToHandle[lastElement] = -1;
+		--numElements;
+		// free the handle
+		handleToElement[handle] = -1;
+		freeHandles.push_back(handle);
 	}
 
 	void SparseBuffer::Dispose()
 	{
+		for (auto& fence : fences)
+			if (fence != nullptr)
+			{
+				glDeleteSync(GLsync(fence));
+				fence = nullptr;
+			}
+		if (mappedMemory != nullptr)
+		{
+			glUnmapNamedBuffer(buffer);
+			mappedMemory = nullptr;
+		}
 		DeleteBuffer(buffer);
 	}
 
-	void SparseBuffer::Draw() const
+	void SparseBuffer::MarkDirty(int firstElement, int numElements)
 	{
-		if (firstFreeSlotAtEnd == 0)
+		if (numElements <= 0)
 			return;
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer);
-		int numInstances = firstFreeSlotAtEnd;
-		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, numInstances); // 6: num of quad vertices (2 triangles)
+		for (int i = 0; i < NUM_SECTIONS; ++i)
+		{
+			// merge with the existing range, if any
+			if (dirtyBegin[i] >= dirtyEnd[i])
+			{
+				dirtyBegin[i] = firstElement;
+				dirtyEnd[i] = firstElement + numElements;
+			}
+			else
+			{
+				dirtyBegin[i] = glm::min(dirtyBegin[i], firstElement);
+				dirtyEnd[i] = glm::max(dirtyEnd[i], firstElement + numElements);
+			}
+		}
 	}
 
-	void* SparseBuffer::MapMemory(int firstElement, int numElements, int access)
+	void SparseBuffer::WaitForSection(int section) const
 	{
-		return glMapNamedBufferRange(buffer, firstElement*stride, numElements*stride, access);
+		auto& fence = fences[section];
+		if (fence != nullptr)
+		{
+			// the section must not be written until the GPU is really done with it, so keep waiting if the wait times out
+			GLenum result;
+			do
+				result = glClientWaitSync(GLsync(fence), GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+			while (result == GL_TIMEOUT_EXPIRED);
+			if (result == GL_WAIT_FAILED)
+			{
+				// the fence is unusable, so the only safe option left is to wait for all GPU work
+				std::cerr << "[ERROR] SparseBuffer: waiting for a fence failed" << std::endl;
+				assert(false);
+				glFinish();
+			}
+			glDeleteSync(GLsync(fence));
+			fence = nullptr;
+		}
 	}
 
-	void SparseBuffer::UnmapMemory()
+	void SparseBuffer::Flush() const
 	{
-		glUnmapNamedBuffer(buffer);
+		// if the section we draw from is up to date, there's nothing to do
+		if (dirtyBegin[currentSection] >= dirtyEnd[currentSection])
+			return;
+
+		// move to the next section, waiting until the GPU is done with any commands that use it
+		currentSection = (currentSection + 1) % NUM_SECTIONS;
+		WaitForSection(currentSection);
+
+		// copy everything that has changed since this section was last written, as a single block
+		auto begin = dirtyBegin[currentSection];
+		auto end = dirtyEnd[currentSection];
+		memcpy(mappedMemory + size_t(currentSection) * sectionBytes + size_t(begin) * stride, shadow.data() + size_t(begin) * stride, size_t(end - begin) * stride);
+		dirtyBegin[currentSection] = dirtyEnd[currentSection] = 0;
+	}
+
+	void SparseBuffer::Draw() const
+	{
+		if (numElements == 0)
+			return;
+		Flush();
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, buffer, GLintptr(currentSection) * sectionBytes, GLsizeiptr(numElements) * stride);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, numElements); // 6: num of quad vertices (2 triangles)
+
+		// remember when the GPU will be done with this section, replacing any older fence for it
+		auto& fence = fences[currentSection];
+		if (fence != nullptr)
+			glDeleteSync(GLsync(fence));
+		fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 	}
 
 	void SparseBuffer::Clear()
 	{
-		if (firstFreeSlotAtEnd > 0)
-		{
-			auto memory = MapMemory(GL_MAP_WRITE_BIT);
-			memset(memory, 0, firstFreeSlotAtEnd * stride);
-			UnmapMemory();
-		}
-		freeSlots.clear();
-		firstFreeSlotAtEnd = 0;
+		// nothing past numElements is drawn, so we don't need to touch the data
+		handleToElement.clear();
+		elementToHandle.clear();
+		freeHandles.clear();
+		numElements = 0;
 	}
-}
\ No newline at end of file
+}
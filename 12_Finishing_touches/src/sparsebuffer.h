@@ -1,58 +1,92 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
-#include <set>
+#include <vector>
 
 namespace rlf
 {
 	// Wrapper class for an OpenGL buffer used for sparse rendering of elements (creatures, items, gui elements, etc. Anything but wall/floor)
+	// All writes go to a CPU copy of the data, and we only track which range has changed. When drawing, the changes are copied in one go to a 
+	// persistently mapped GPU buffer, which is split into a ring of sections so that we never write to memory that the GPU is still reading
+	// Elements are kept packed at the front of the buffer, so that we never draw removed elements. Add() returns a handle that stays valid
+	// even when elements move around to fill holes
 	class SparseBuffer
 	{
 	public:
 		// Make sure the buffer is released before destroying the object
 		~SparseBuffer()  { Dispose(); }
 
-		// Initialize the buffer, using the size of each elements in bytes (stride) and the max number of elements that we can allocate
+		// Initialize the buffer, using the size of each elements in bytes (stride) and the initial number of elements that we can store. The buffer grows as needed
 		void Init(int stride, int numElementsMax);
 		// check if our buffer is initialized
 		bool IsInitialized() const { return buffer != 0; }
 
-		// Add some data (num bytes == stride) at a free slot and return the slot
+		// Add some data (num bytes == stride) and return a handle to it
 		int Add(const void* data);
-		// Update the data at a given slot
-		void Update(int slot, const void* data);
-		// Free up a slot
-		void Remove(int slot);
+		// Update the data for a given handle
+		void Update(int handle, const void* data);
+		// Remove the data for a given handle. The handle can be reused by a later Add
+		void Remove(int handle);
 
-		// Set up several elements at the same time
+		// Set up several elements at the same time. This replaces all existing elements, and invalidates all handles
 		void Set(int numElements, const void* data);
 
 		// Release the buffer
 		void Dispose() ;
 
-		// Draw a number of quad instances, as many as the buffer elements
+		// Draw a number of quad instances, as many as the buffer elements. Any changes are uploaded first
 		void Draw() const;
 
 		// Clear the buffer
 		void Clear();
 
-		// Get a memory pointer from the buffer, access should be GL_MAP_WRITE_BIT if we want to write to it
-		void* MapMemory( int firstElement, int numElements, int access);
-		// Map the entire buffer with given access
-		void* MapMemory(int access) { return MapMemory(0, numElementsMax, access); }
-		// Unmap the mapped buffer memory after MapMemory() -- don't forget to call this! Even better, write a struct that uses RAII to automatically map/unmap within scope
-		void UnmapMemory();
+	private:
+		// number of sections in the GPU buffer ring
+		static constexpr int NUM_SECTIONS = 3;
+
+		// create the GPU buffer for a given capacity, copying the old buffer's data if there is one
+		void Allocate(int capacity);
+		// make sure we can store at least a number of elements, growing geometrically
+		void Reserve(int numElements);
+		// mark a range of elements as changed, for all sections
+		void MarkDirty(int firstElement, int numElements);
+		// if there are any changes, copy them to the next section in the ring and make it current
+		void Flush() const;
+		// wait until the GPU is done with a section
+		void WaitForSection(int section) const;
 
 	private:
 		// the opengl buffer
 		uint32_t buffer=0;
 		// the size of each buffer element, in bytes
 		int stride=0;
-		// max number of elements that can be written to the buffer
+		// max number of elements that can be written to the buffer without growing it
 		int numElementsMax = 0;
-		// store here any free slots, if we want to remove a buffer element
-		std::set<int> freeSlots;
-		// Store the first index into contiguous free space -- nothing is written at/after this index
-		int firstFreeSlotAtEnd=0;
+		// number of elements in use. They are always stored at [0, numElements)
+		int numElements = 0;
+
+		// handle -> element index, or -1 if the handle is free
+		std::vector<int> handleToElement;
+		// element index -> handle, or -1 if the element was added without a handle (via Set)
+		std::vector<int> elementToHandle;
+		// stack of free handles, to be reused
+		std::vector<int> freeHandles;
+
+		// the CPU copy of the buffer data
+		std::vector<uint8_t> shadow;
+
+		// GPU streaming state. Mutable, as drawing needs to upload changes, but that doesn't change the buffer contents
+		// the persistently mapped memory of the whole buffer
+		mutable uint8_t* mappedMemory = nullptr;
+		// size of each section in bytes, aligned for binding as a shader storage buffer range
+		int sectionBytes = 0;
+		// the section that has the most recent data, and that we draw from
+		mutable int currentSection = 0;
+		// for each section, the range of elements [begin, end) that differs from the CPU copy
+		mutable std::array<int, NUM_SECTIONS> dirtyBegin = {};
+		mutable std::array<int, NUM_SECTIONS> dirtyEnd = {};
+		// for each section, a fence (GLsync) placed after the last GPU command that uses it
+		mutable std::array<void*, NUM_SECTIONS> fences = {};
 	};
-}
\ No newline at end of file
+}
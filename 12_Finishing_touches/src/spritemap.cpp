@@ -17,10 +17,9 @@ namespace rlf
 		glBindTexture(GL_TEXTURE_2D, 0);
 	}
 
-	void Spritemap::Draw(uint32_t program) const
+	void Spritemap::Draw() const
 	{
 		glBindTextureUnit(1, texLayer);
-		glUniform1i(glGetUniformLocation(program, "spritemap"), 1);
 
 		// Render the quad
 		glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -16,8 +16,8 @@ namespace rlf
 		// create the texture, given a size and starting data
 		void Init(const glm::ivec2& size, const glm::uvec2 * data);
 
-		// Draw the texture as a quad
-		void Draw(uint32_t program) const;
+		// Draw the texture as a quad. The texture is bound to unit 1, which the program samples as "spritemap"
+		void Draw() const;
 
 		// Release the buffer
 		void Dispose();
@@ -215,6 +215,8 @@ namespace rlf
 					auto bufferData = TileData('*',glm::vec4(1,1,1,1)).PackSparse(gfx.WorldToScreen(projectilePath[ptIdx]));
 					sparseBufferFx.Set(1, &bufferData);
 					Graphics::Instance().RenderGameOverlay(sparseBufferFx);
+					// keep rendering while the projectile is moving
+					FrameworkApp::RequestRedraw();
 				}
 				else
 					projectilePath.clear();
@@ -80,30 +80,13 @@ namespace rlf
 			std::unique_ptr<State> newState(new state::MainGame());
 			Game::Instance().PushState(newState);
 
-			// Initialize the game state
-			Game::Instance().New();
-
-			// set the level to first
-			ChangeLevel(0);
-
-			// find suitable position for the player (entry staircase)
-			const auto& entities = Game::Instance().CurrentLevel().Entities();
-			auto itFound = std::find_if(entities.begin(), entities.end(), [](const EntityId& entityId) {
-				return entityId.Entity()->DbCfg() == DbIndex::StairsUp();
-			});
-			auto startPosition = itFound->Entity()->GetLocation().position;
-
-			// Create the player entity
-			EntityDynamicConfig dcfg;
-			dcfg.position = startPosition;
-			dcfg.nameOverride = charName;
-			// add one of each item, for debugging purposes!
-			for (const auto& kv : Db::Instance().All())
-				if (kv.second.allowRandomSpawn && kv.second.type == EntityType::Item)
-					dcfg.inventory.emplace_back(kv.first);
-			DbIndex cfgdb{ "player" };
-			auto player = Game::Instance().CreateEntity(cfgdb, dcfg, true).Entity();
-			Game::Instance().SetPlayer(*player);
+			// Initialize the game state and create the player
+#ifndef _DEBUG // true random in release mode
+			auto seed = RandomSeed();
+#else	// same-seed in debug mode
+			uint64_t seed = 2;
+#endif
+			Game::Instance().StartNewGame(charName, seed);
 		}
 
 		void Menu::ContinueGame()
@@ -1,7 +1,10 @@
 #include "selecttarget.h"
 
+#include <cmath>
+
 #include <GLFW/glfw3.h>
 #include "input.h"
+#include "framework.h"
 #include "../graphics.h"
 
 namespace rlf
@@ -66,6 +69,10 @@ namespace rlf
 			gfx.RenderGui();
 			gfx.RenderHeader();
 			gfx.RenderTargets(sparseBuffer, targetIndex);
+
+			// the selected target blinks, so redraw when it toggles
+			auto blinkPeriod = Graphics::TARGET_BLINK_PERIOD;
+			FrameworkApp::RequestRedrawAt((std::floor(FrameworkApp::Time() / blinkPeriod) + 1.0) * blinkPeriod);
 		}
 	}
 }
\ No newline at end of file
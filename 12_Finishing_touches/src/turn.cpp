@@ -13,20 +13,20 @@ namespace rlf
 		if (player == nullptr || waitingForPlayerAction)
 			return;
 
-		// Play all creature entities except player
+		// Play all creature entities except player. Only the ones that can see the player do anything for now
 		const auto& level = Game::Instance().CurrentLevel();
-		for(const auto& entityId : level.Entities())
+		level.CreaturesThatSeePlayer(activeCreatures);
+		for(const auto& entityId : activeCreatures)
 		{
 			auto entity = entityId.Entity();
-			if (entity != nullptr && entity->Type() == EntityType::Creature && entity != player)
+			if (entity != nullptr)
 			{
 				// Run AI: move and bump attack
-				if (level.EntityHasLineOfSightTo(*entity, player->GetLocation().position))
-				{
-					auto path = level.CalcPath(*entity, player->GetLocation().position);
-					if (!path.empty())
-						MoveAdj(*entity, path.at(0) - entity->GetLocation().position);
-				}
+				// all creatures share the level's approach map, so this doesn't run a pathfinding search per creature
+				auto position = entity->GetLocation().position;
+				auto nextPosition = level.NextPositionTowardsPlayer(*entity);
+				if (nextPosition != position)
+					MoveAdj(*entity, nextPosition - position);
 			}
 		}
 
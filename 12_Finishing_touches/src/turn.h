@@ -1,6 +1,7 @@
 #pragma once
 
 #include <deque>
+#include <vector>
 
 #include "entityid.h"
 
@@ -19,5 +20,7 @@ namespace rlf
 	private:
 		// set this to true if Process should NOT iterate over enemies, but it should wait until player is done, e.g. with selecting a target from the gui
 		bool waitingForPlayerAction = true;
+		// scratch list of the creatures that act this turn, reused to avoid allocating every turn
+		std::vector<EntityId> activeCreatures;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace rlf
+{
+	// Index of the lowest/highest set bit of a non-zero word
+	inline int LowestSetBit(uint64_t word)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return int(index);
+#else
+		return __builtin_ctzll(word);
+#endif
+	}
+	inline int HighestSetBit(uint64_t word)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, word);
+		return int(index);
+#else
+		return 63 - __builtin_clzll(word);
+#endif
+	}
+
+	// A 2D array of bits, packed in 64-bit words. Each row starts at a new word, so that rows can be scanned a word at a time
+	class BitArray2D
+	{
+	public:
+		BitArray2D() = default;
+
+		// Ctor providing the size and a default value for all bits
+		BitArray2D(const glm::ivec2& size, bool value = false)
+			:size(size), wordsPerRow((size.x + 63) / 64), words(size_t(wordsPerRow) * size.y, value ? ~uint64_t(0) : uint64_t(0)) {}
+
+		// Get size and the number of words in each row
+		const glm::ivec2& Size() const { return size; }
+		int WordsPerRow() const { return wordsPerRow; }
+
+		// bit access
+		bool Get(int x, int y) const { return (words[Word(x, y)] >> (x & 63)) & 1; }
+		bool Get(const glm::ivec2& p) const { return Get(p.x, p.y); }
+		void Set(int x, int y, bool value)
+		{
+			const auto mask = uint64_t(1) << (x & 63);
+			auto& word = words[Word(x, y)];
+			word = value ? (word | mask) : (word & ~mask);
+		}
+		void Set(const glm::ivec2& p, bool value) { Set(p.x, p.y, value); }
+
+		// raw access to a row's words. Bit x of the row is bit (x & 63) of word (x / 64). Padding bits past the row width are unspecified
+		const uint64_t* Row(int y) const { return words.data() + size_t(y) * wordsPerRow; }
+
+		// check if a coordinate is inside the bounds of the 2D array
+		bool InBounds(int x, int y) const { return x >= 0 && x < size.x && y >= 0 && y < size.y; }
+		bool InBounds(const glm::ivec2& p) const { return InBounds(p.x, p.y); }
+
+	private:
+		size_t Word(int x, int y) const { return size_t(y) * wordsPerRow + (x >> 6); }
+
+	private:
+		// Size of array (width, height)
+		glm::ivec2 size = { 0,0 };
+		// number of 64-bit words used for each row
+		int wordsPerRow = 0;
+		// the bits, stored row by row
+		std::vector<uint64_t> words;
+	};
+}
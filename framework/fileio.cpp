@@ -0,0 +1,106 @@
+#include "fileio.h"
+
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include <fmt/format.h>
+
+namespace fs = std::filesystem;
+
+namespace rlf
+{
+    std::string ReadTextFile(const std::string& path)
+    {
+        std::stringstream buffer;
+        std::ifstream ifsdb(path);
+        if (ifsdb.is_open())
+            buffer << ifsdb.rdbuf();
+        else
+            std::cerr << "Error opening file for reading: " << path << std::endl;
+        return buffer.str();
+    }
+
+    void WriteTextFile(const std::string& path, const std::string& text)
+    {
+        std::ofstream myfile(path);
+        if (myfile.is_open())
+            myfile << text;
+        else
+            std::cerr << "Error opening file for writing: " << path << std::endl;
+    }
+
+    std::string ReadBinaryFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Error opening file for reading: " << path << std::endl;
+            return {};
+        }
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void WriteBinaryFile(const std::string& path, const std::string& data)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (file.is_open())
+            file.write(data.data(), std::streamsize(data.size()));
+        else
+            std::cerr << "Error opening file for writing: " << path << std::endl;
+    }
+
+    bool ReplaceBinaryFile(const std::string& path, const std::string& data)
+    {
+        auto tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                std::cerr << "Error opening file for writing: " << tempPath << std::endl;
+                return false;
+            }
+            file.write(data.data(), std::streamsize(data.size()));
+            file.flush();
+            if (!file)
+            {
+                std::cerr << "Error writing file: " << tempPath << std::endl;
+                return false;
+            }
+        }
+        std::error_code error;
+        fs::rename(tempPath, path, error);
+        if (error)
+        {
+            std::cerr << "Error renaming " << tempPath << " to " << path << ": " << error.message() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::string MediaSearch(const std::string& filename)
+    {
+        static const std::string media_path_prefixes[] = {
+            "",                                                       // for absolute paths
+            "media/",                                                 // for relative paths to the media folder in the working directory (e.g. exe file)
+            fs::path(__FILE__).parent_path().string() + "/../media/"  // for relative paths to the media folder in the repository
+        };
+
+        for (const auto& media_path_prefix : media_path_prefixes)
+        {
+            std::string fullpath = media_path_prefix + filename;
+            std::cout << "Combining " << media_path_prefix << " and " << filename << " yields " << fullpath << ".\n";
+            fs::path path = fullpath;
+            if (fs::exists(path))
+            {
+                fmt::print("mediaSearch: found media file {0}\n", path.string());
+                return path.string();
+            }
+        }
+        // could not find the path, return empty string
+        fmt::print("mediaSearch: ERROR could not find media file {0}\n", filename);
+        return {};
+    }
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+// File utilities. These don't need OpenGL, so they are kept apart from utility.h, and can be used by non-graphical builds
+namespace rlf
+{
+	// Read/write a whole text file. On failure, print an error (and return an empty string when reading)
+	std::string ReadTextFile(const std::string& path);
+	void WriteTextFile(const std::string& path, const std::string& text);
+	// Read/write a whole file as raw bytes, without any newline translation
+	std::string ReadBinaryFile(const std::string& path);
+	void WriteBinaryFile(const std::string& path, const std::string& data);
+	// Write a whole file as raw bytes, by writing a temporary file and renaming it over the old one, so that the file is never left half-written. Return if successful
+	bool ReplaceBinaryFile(const std::string& path, const std::string& data);
+
+	// Searches a media filename (shader, texture, model, etc)
+	std::string MediaSearch(const std::string& path);
+}
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "framework.h"
 
 // C++
+#include <algorithm>
+#include <limits>
 #include <string>
 #include <iostream>
 #include <filesystem>
@@ -23,6 +25,11 @@ GLFWwindow* glfWindow = NULL;
 
 int rlf::FrameworkApp::viewportWidth = 0;
 int rlf::FrameworkApp::viewportHeight = 0;
+int rlf::FrameworkApp::numRedrawFrames = 1;
+double rlf::FrameworkApp::redrawTime = std::numeric_limits<double>::infinity();
+
+// Input changes the application state, so always redraw after it. Render 2 frames, as Dear ImGui might need an extra frame to process the input
+static constexpr int NUM_REDRAW_FRAMES_AFTER_INPUT = 2;
 
 // Callback for GLFW related errors
 static void glfw_error_callback(int error, const char* description)
@@ -33,16 +40,25 @@ static void glfw_error_callback(int error, const char* description)
 static void glfw_key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
     rlf::Input::KeyCallback(key, action);
+    rlf::FrameworkApp::RequestRedraw(NUM_REDRAW_FRAMES_AFTER_INPUT);
 }
 
 static void glfw_mcur_callback(GLFWwindow* window, double xpos, double ypos)
 {
     rlf::Input::MouseCursorCallback((float)xpos, (float)ypos);
+    rlf::FrameworkApp::RequestRedraw(NUM_REDRAW_FRAMES_AFTER_INPUT);
 }
 
 static void glfw_mbtn_callback(GLFWwindow* window, int button, int action, int mods)
 {
     rlf::Input::MouseButtonCallback(button, action);
+    rlf::FrameworkApp::RequestRedraw(NUM_REDRAW_FRAMES_AFTER_INPUT);
+}
+
+// The window contents need to be redrawn, e.g. after it was uncovered
+static void glfw_refresh_callback(GLFWwindow* window)
+{
+    rlf::FrameworkApp::RequestRedraw();
 }
 
 // Taken from https://learnopengl.com/In-Practice/Debugging
@@ -159,6 +175,7 @@ bool initializeGLFW(const rlf::FrameworkApp::WindowSettings& settings)
     glfwSetKeyCallback(glfWindow, glfw_key_callback);
     glfwSetMouseButtonCallback(glfWindow, glfw_mbtn_callback);
     glfwSetCursorPosCallback(glfWindow, glfw_mcur_callback);
+    glfwSetWindowRefreshCallback(glfWindow, glfw_refresh_callback);
 
     glfwMakeContextCurrent(glfWindow);
     // VSync
@@ -209,6 +226,16 @@ namespace rlf
         return glfwGetTime();
     }
 
+    void FrameworkApp::RequestRedraw(int numFrames)
+    {
+        numRedrawFrames = std::max(numRedrawFrames, numFrames);
+    }
+
+    void FrameworkApp::RequestRedrawAt(double time)
+    {
+        redrawTime = std::min(redrawTime, time);
+    }
+
 	int FrameworkApp::run()
 	{
         // framework initialisation
@@ -239,6 +266,23 @@ namespace rlf
             // user-defined update code
             onUpdate();
 
+            // when rendering on demand, skip the frame unless something requested it
+            if (settings.renderOnDemand && numRedrawFrames == 0 && Time() < redrawTime)
+            {
+                Input::ResetState();
+                // sleep until we get an event, a scheduled redraw is due, or the idle timeout expires
+                auto waitTime = std::min(settings.idleTimeout, redrawTime - Time());
+                if (waitTime > 0.0)
+                    glfwWaitEventsTimeout(waitTime);
+                else
+                    glfwPollEvents();
+                continue;
+            }
+            // consume the redraw request. Requests made while rendering (e.g. by ongoing animations) will apply to the next frame
+            numRedrawFrames = std::max(numRedrawFrames - 1, 0);
+            if (Time() >= redrawTime)
+                redrawTime = std::numeric_limits<double>::infinity();
+
             // user-defined rendering code
             onRender();
 
@@ -14,6 +14,8 @@ namespace rlf
 		{
 			bool fullscreen = false;
 			int samples = -1; // for multisampling. By default don't force any option
+			bool renderOnDemand = false; // if true, only render frames that have been requested (input, RequestRedraw), and sleep until events arrive otherwise
+			double idleTimeout = 0.5; // when rendering on demand, the maximum time (in seconds) to sleep without events. Update is called at least this often
 		};
 
 		~FrameworkApp() = default;
@@ -45,6 +47,11 @@ namespace rlf
 		static int ViewportHeight() { return viewportHeight; }
 		static double Time();
 
+		// When rendering on demand, request that the next few frames are rendered. Input events request redraws automatically
+		static void RequestRedraw(int numFrames = 1);
+		// When rendering on demand, request a redraw at a given time (e.g. for animations that change at known times)
+		static void RequestRedrawAt(double time);
+
 	protected: 
 		// Allow subclasses to modify settings, e.g. via the configure method
 		WindowSettings settings;
@@ -54,5 +61,9 @@ namespace rlf
 		static int viewportWidth;
 		static int viewportHeight;
 
+		// redraw requests: number of frames to render and the earliest time that a frame should be rendered
+		static int numRedrawFrames;
+		static double redrawTime;
+
 	};
 }
\ No newline at end of file
@@ -29,50 +29,6 @@ using namespace glm;
 
 namespace rlf
 {
-    std::string ReadTextFile(const std::string& path)
-    {
-        std::stringstream buffer;
-        std::ifstream ifsdb(path);
-        if (ifsdb.is_open())
-            buffer << ifsdb.rdbuf();
-        else
-            std::cerr << "Error opening file for reading: " << path << std::endl;
-        return buffer.str();
-    }
-
-    void WriteTextFile(const std::string& path, const std::string& text)
-    {
-        std::ofstream myfile(path);
-        if (myfile.is_open())
-            myfile << text;
-        else
-            std::cerr << "Error opening file for writing: " << path << std::endl;
-    }
-
-    std::string MediaSearch(const std::string& filename)
-    {
-        static const std::string media_path_prefixes[] = {
-            "",                                                       // for absolute paths
-            "media/",                                                 // for relative paths to the media folder in the working directory (e.g. exe file)
-            fs::path(__FILE__).parent_path().string() + "/../media/"  // for relative paths to the media folder in the repository
-        };
-
-        for (const auto& media_path_prefix : media_path_prefixes)
-        {
-            std::string fullpath = media_path_prefix + filename;
-            std::cout << "Combining " << media_path_prefix << " and " << filename << " yields " << fullpath << ".\n";
-            fs::path path = fullpath;
-            if (fs::exists(path))
-            {
-                fmt::print("mediaSearch: found media file {0}\n", path.string());
-                return path.string();
-            }
-        }
-        // could not find the path, return empty string
-        fmt::print("mediaSearch: ERROR could not find media file {0}\n", filename);
-        return {};
-    }
-
     GLuint BuildShader(const char* vsource, const char* fsource)
     {
         GLuint shaderProgram = 0;
@@ -211,8 +167,8 @@ namespace rlf
     {
         if (buffer != 0)
         {
-            buffer = 0;
             glDeleteBuffers(1, &buffer);
+            buffer = 0;
         }
     }
    
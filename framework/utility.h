@@ -5,14 +5,10 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include "fileio.h"
+
 namespace rlf
 {
-	std::string ReadTextFile(const std::string& path);
-	void WriteTextFile(const std::string& path, const std::string& text);
-
-	// Searches a media filename (shader, texture, model, etc)
-	std::string MediaSearch(const std::string& path);
-
 	// This takes as parameters the shader TEXT (not the filename)
 	GLuint BuildShader(const char* vsource, const char* fsource);
 
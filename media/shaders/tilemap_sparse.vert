@@ -10,7 +10,16 @@
 layout (location = 0) in vec3 aPos;
 
 uniform ivec2 screen_grid_size;
+#ifdef RLF_FRAME_UBO
+// per-frame values shared by all programs, in a single uniform buffer
+layout (std140, binding = 1) uniform FrameBlock {
+	ivec2 tilemap_tile_num;
+	ivec2 tilemap_tile_size;
+	ivec2 camera_offset;
+};
+#else
 uniform ivec2 camera_offset;
+#endif
 
 out vec2 uv;
 flat out ivec2 cell_idx;
@@ -6,8 +6,17 @@
  
 
 uniform sampler2D tilemap;
+#ifdef RLF_FRAME_UBO
+// per-frame values shared by all programs, in a single uniform buffer
+layout (std140, binding = 1) uniform FrameBlock {
+	ivec2 tilemap_tile_num;
+	ivec2 tilemap_tile_size;
+	ivec2 camera_offset;
+};
+#else
 uniform ivec2 tilemap_tile_num;
 uniform ivec2 tilemap_tile_size;
+#endif
 
 uniform sampler2D fow;
 